@@ -0,0 +1,179 @@
+#include "Bitboard.hpp"
+#include "ConsoleRenderer.hpp"
+#include "Field.hpp"
+#include "Logic.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "Simulation.hpp"
+#include "TestLevels.hpp"
+#include "World.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// Arguments: field size, room count.
+void fieldArguments(benchmark::internal::Benchmark *benchmark) {
+    benchmark->ArgNames({"size", "rooms"});
+    for (const auto &[fieldSize, roomCount] : {std::pair{64, 8}, std::pair{512, 200}, std::pair{4096, 5000}}) {
+        benchmark->Args({fieldSize, roomCount});
+    }
+}
+
+void BM_FieldContains(benchmark::State &state) {
+    const auto field = makeField(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    auto random = Random{1};
+    std::vector<Position> positions(4096);
+    for (auto &pos : positions) {
+        pos = field.rect.pos + Position{random.nextInt(0, field.rect.size.width - 1), random.nextInt(0, field.rect.size.height - 1)};
+    }
+    for (auto _ : state) {
+        int count = 0;
+        for (const auto pos : positions) {
+            count += field.contains(pos) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(positions.size()));
+}
+BENCHMARK(BM_FieldContains)->Apply(fieldArguments);
+
+void BM_FieldFilterPositions(benchmark::State &state) {
+    const auto field = makeField(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    for (auto _ : state) {
+        auto positions = field.filterPositions([](Position pos) { return (pos.x + pos.y) % 2 == 0; });
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * field.rect.size.area());
+}
+BENCHMARK(BM_FieldFilterPositions)->Apply(fieldArguments)->Unit(benchmark::kMicrosecond);
+
+void BM_FieldBuild(benchmark::State &state) {
+    for (auto _ : state) {
+        auto field = makeField(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+        benchmark::DoNotOptimize(field.tiles.data());
+    }
+}
+BENCHMARK(BM_FieldBuild)->Apply(fieldArguments)->Unit(benchmark::kMicrosecond);
+
+void BM_RandomValidFieldPosition(benchmark::State &state) {
+    auto world = World{makeField(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)))};
+    world.random = Random{2};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(world.randomValidFieldPosition([](Position) { return true; }));
+    }
+}
+BENCHMARK(BM_RandomValidFieldPosition)->Apply(fieldArguments);
+
+// Arguments: robot count, strategy. One iteration moves every robot once. The player does not move,
+// so a new game is started every `cTurnsPerGame` iterations, outside of the measurement, before the
+// robots have caught up with the player and only stand still.
+void BM_RobotAdvance(benchmark::State &state) {
+    constexpr int cTurnsPerGame = 64;
+    const auto robotCount = static_cast<int>(state.range(0));
+    const auto strategy = static_cast<RobotStrategy>(state.range(1));
+    auto logic = Logic{World{makeField(1024, 1000)}, strategy};
+    const auto runRandom = Random{3};
+    uint64_t game = 0;
+    int turn = 0;
+    logic.startGame(runRandom.stream(game++), robotCount);
+    for (auto _ : state) {
+        if (turn++ == cTurnsPerGame) {
+            state.PauseTiming();
+            logic.startGame(runRandom.stream(game++), robotCount);
+            turn = 1;
+            state.ResumeTiming();
+        }
+        logic.robotLogic.prepareTurn(logic.world);
+        for (std::size_t robotIndex = 0; robotIndex < logic.world.robots.size(); ++robotIndex) {
+            logic.robotLogic.advance(robotIndex, logic.world);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * robotCount);
+}
+BENCHMARK(BM_RobotAdvance)
+    ->ArgNames({"robots", "strategy"})
+    ->ArgsProduct({{3, 64, 1024, 16384}, {static_cast<int64_t>(RobotStrategy::Greedy), static_cast<int64_t>(RobotStrategy::FlowField)}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Renders the world and encodes the frame for the console, without writing it anywhere.
+// Arguments: 1 to encode the full frame every time, 0 to encode only the changes; the canvas size.
+template<typename tEncoding>
+void BM_Render(benchmark::State &state) {
+    const auto fullFrame = state.range(0) != 0;
+    const auto canvasSize = static_cast<int>(state.range(1));
+    auto logic = Logic{World{makeField(512, 200)}};
+    logic.startGame(Random{4}, 16);
+    auto canvas = Canvas{Size{canvasSize * 2, canvasSize}};
+    auto renderer = BasicConsoleRenderer<tEncoding>{};
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        canvas.clear();
+        logic.render(canvas);
+        if (fullFrame) { renderer.invalidate(); }
+        const auto output = renderer.render(canvas);
+        bytes += output.size();
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+}
+BENCHMARK_TEMPLATE(BM_Render, AnsiEncoding)
+    ->ArgNames({"full", "height"})->ArgsProduct({{0, 1}, {40, 256}})->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Render, Ansi256Encoding)->ArgNames({"full", "height"})->Args({1, 256})->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Render, TrueColorEncoding)->ArgNames({"full", "height"})->Args({1, 256})->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Render, AsciiEncoding)->ArgNames({"full", "height"})->Args({1, 256})->Unit(benchmark::kMicrosecond);
+
+// Plays one complete game per iteration. The first games grow the containers of the logic to
+// their final size, so they are played before the measurement. With `ROBOT_ESCAPE_PROFILING`,
+// the `allocations/game` counter shows the heap allocations of the games that follow, which
+// should be zero.
+template<typename tLogic>
+void playFullGames(benchmark::State &state, const Simulation &simulation) {
+    constexpr uint64_t cWarmUpGames = 4;
+    auto runner = GameRunner<tLogic>{simulation};
+    runner.warmUp(cWarmUpGames);
+    const auto allocationsBefore = Profiler::allocationCount;
+    for (auto _ : state) {
+        runner.playGame();
+    }
+    const auto allocations = Profiler::allocationCount - allocationsBefore; // before the counters allocate.
+    state.SetItemsProcessed(state.iterations());
+    state.counters["turns/game"] = runner.statistics.averageTurns();
+    if constexpr (cProfilingEnabled) {
+        state.counters["allocations/game"] = static_cast<double>(allocations) / static_cast<double>(state.iterations());
+    }
+}
+
+// Arguments: field size, room count, robot count.
+void BM_FullGame(benchmark::State &state) {
+    playFullGames<Logic>(state, Simulation{
+        .field = makeField(static_cast<int>(state.range(0)), static_cast<int>(state.range(1))),
+        .robotCount = static_cast<int>(state.range(2)),
+        .robotStrategy = RobotStrategy::FlowField,
+        .playerPolicy = PlayerPolicy::BfsToExit,
+        .maxTurns = 1000,
+    });
+}
+BENCHMARK(BM_FullGame)
+    ->ArgNames({"size", "rooms", "robots"})
+    ->Args({64, 8, 3})
+    ->Args({512, 200, 50})
+    ->Args({4096, 5000, 1000})
+    ->Unit(benchmark::kMicrosecond);
+
+// Arguments: robot count, strategy. The games are played on a 64x64 field with bit planes.
+void BM_BitboardFullGame(benchmark::State &state) {
+    playFullGames<BitboardLogic>(state, Simulation{
+        .field = makeField(64, 8),
+        .robotCount = static_cast<int>(state.range(0)),
+        .robotStrategy = static_cast<RobotStrategy>(state.range(1)),
+        .playerPolicy = PlayerPolicy::BfsToExit,
+        .maxTurns = 1000,
+    });
+}
+BENCHMARK(BM_BitboardFullGame)
+    ->ArgNames({"robots", "strategy"})
+    ->ArgsProduct({{3, 16}, {static_cast<int64_t>(RobotStrategy::Greedy), static_cast<int64_t>(RobotStrategy::FlowField)}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
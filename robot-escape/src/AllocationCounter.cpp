@@ -0,0 +1,16 @@
+#include "Profiler.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef ROBOT_ESCAPE_PROFILING
+// Count the allocations for the `--profile` summary. This is a separate translation unit,
+// so the replaced functions are never inlined into the code that uses them.
+auto operator new(std::size_t size) -> void* {
+    Profiler::countAllocation();
+    if (auto *ptr = std::malloc(size == 0 ? 1 : size)) { return ptr; }
+    throw std::bad_alloc{};
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
@@ -1,37 +1,245 @@
 #pragma once
 
 #include "Canvas.hpp"
+#include "ConsoleRenderer.hpp"
+#include "GameServer.hpp"
+#include "Heatmap.hpp"
+#include "LevelFile.hpp"
+#include "LevelGenerator.hpp"
+#include "LevelWatcher.hpp"
+#include "LoadTest.hpp"
 #include "Logic.hpp"
+#include "Profiler.hpp"
+#include "RealtimeGame.hpp"
+#include "Replay.hpp"
+#include "Simulation.hpp"
+#include "Solver.hpp"
 #include "World.hpp"
 
 #include <erbsland/all_conf.hpp>
 
+#include <charconv>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 using el::conf::Parser;
 using el::conf::Source;
 using el::conf::DocumentPtr;
 using el::conf::ValuePtr;
 using el::conf::Error;
+using el::conf::String;
+
+enum class Command {
+    Play,
+    Simulate,
+    Compile,
+    Replay,
+    Solve,
+    Generate,
+    Serve,
+    LoadTest,
+};
+
+enum class LevelFormat {
+    Configuration,
+    Compiled,
+};
 
 struct Application {
+    Command command{Command::Play};
     std::filesystem::path configPath;
+    std::filesystem::path outputPath;
+    std::filesystem::path replayPath;
+    std::optional<std::filesystem::path> recordPath; // set by `--record`, where the games are recorded.
+    int replayFramesPerSecond{0}; // 0 to replay without rendering.
+    std::optional<int> realtimeTicksPerSecond; // set by `--realtime`, the robots move without waiting for the player.
     DocumentPtr config;
+    std::optional<std::uint64_t> seed;
+    std::optional<std::filesystem::path> profilePath; // set by `--profile`, where the JSON summary is written.
+    std::uint64_t simulationGames{10000};
+    unsigned simulationThreads{WorkStealingPool::defaultThreadCount()};
+    PlayerPolicy simulationPolicy{PlayerPolicy::BfsToExit};
+    SimulationBackend simulationBackend{SimulationBackend::Automatic};
+    std::optional<std::filesystem::path> heatmapPrefix; // set by `--heatmap`, the start of the heatmap file names.
+    std::optional<HeatmapLayer> shownHeatmapLayer; // set by `--show-heatmap`, drawn over the level after a simulation.
+    std::optional<int> maxTurns; // set by `--max-turns`, the default depends on the command.
+    std::uint64_t generatorLevels{100};
+    LevelFormat generatorFormat{LevelFormat::Configuration};
+    ServerAddress serverAddress;
+    int loadTestClients{100};
+    bool watchLevel{false}; // set by `--watch`, the server reloads the level when its file changes.
+    Canvas canvas;
+    ConsoleEncoding consoleEncoding{ConsoleEncoding::Ansi};
+    ConsoleRenderer renderer;
 
-    constexpr static auto cMinimumFieldSize = Size{8, 8};
-    constexpr static auto cMaximumFieldSize = Size{80, 40};
     constexpr static auto cMinimumCanvasSize = Size{32, 16};
+    constexpr static auto cMaximumCanvasSize = Size{80, 40};
+    constexpr static auto cDefaultRobotCount = 3;
+    constexpr static auto cMaximumRobotCount = 100000;
+    constexpr static auto cCanvasScreenRow = 5;
+    constexpr static auto cDefaultSimulationTurns = 1000;
+    constexpr static auto cDefaultProfilePath = "robot-escape-profile.json";
+    constexpr static auto cDefaultTicksPerSecond = 4;
+    constexpr static auto cMaximumTicksPerSecond = 1000;
+
+    [[noreturn]] static void exitWithUsage(const char *programName) {
+        std::cout << "Usage: " << programName << " <config-file|level-file> [--realtime[=<ticks-per-second>]]\n"
+            << "       " << programName << " simulate <config-file> [--games=<n>] [--policy=random|greedy|bfs]"
+            << " [--max-turns=<n>] [--threads=<n>] [--backend=auto|field|bitboard]\n"
+            << "                [--heatmap=<file-prefix>] [--show-heatmap=player|robots|captures]\n"
+            << "       " << programName << " compile <config-file> <level-file>\n"
+            << "       " << programName << " replay <config-file|level-file> <replay-file> [--fps=<n>] [--threads=<n>]\n"
+            << "       " << programName << " solve <config-file|level-file> [--max-turns=<n>]\n"
+            << "       " << programName << " generate <config-file> <output-directory> [--levels=<n>]"
+            << " [--format=elcl|level] [--threads=<n>]\n"
+            << "       " << programName << " serve <config-file|level-file> [--socket=<path>|--port=<n>] [--threads=<n>] [--watch]\n"
+            << "       " << programName << " load-test <config-file|level-file> [--socket=<path>|--port=<n>] [--clients=<n>]"
+            << " [--games=<n>] [--policy=random|greedy|bfs] [--max-turns=<n>]\n"
+            << "Options: --seed=<n> makes the placement and all robot decisions reproducible.\n"
+            << "         --record=<replay-file> records all played or simulated games.\n"
+            << "         --profile[=<json-file>] prints the time spent per phase at exit and writes it as JSON.\n"
+            << "         --terminal=ansi|256|truecolor|ascii selects the colors and glyphs of the game and the replays.\n";
+        exit(1);
+    }
+
+    template<typename T>
+    [[nodiscard]] static auto parseNumber(std::string_view text, T &value) noexcept -> bool {
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return error == std::errc{} && end == text.data() + text.size();
+    }
+
+    [[nodiscard]] auto parseOption(std::string_view name, std::string_view value) -> bool {
+        if (name == "games") { return parseNumber(value, simulationGames); }
+        if (name == "seed") { return parseNumber(value, seed.emplace()); }
+        if (name == "threads") { return parseNumber(value, simulationThreads) && simulationThreads > 0; }
+        if (name == "max-turns") { return parseNumber(value, maxTurns.emplace()) && *maxTurns > 0; }
+        if (name == "record") {
+            recordPath = std::filesystem::path{value};
+            return !value.empty();
+        }
+        if (name == "levels") { return parseNumber(value, generatorLevels); }
+        if (name == "format") {
+            if (value == "elcl") { generatorFormat = LevelFormat::Configuration; return true; }
+            if (value == "level") { generatorFormat = LevelFormat::Compiled; return true; }
+            return false;
+        }
+        if (name == "socket") {
+            serverAddress.socketPath = std::filesystem::path{value};
+            return !value.empty();
+        }
+        if (name == "port") { return parseNumber(value, serverAddress.port) && serverAddress.port > 0 && serverAddress.port < 65536; }
+        if (name == "watch") {
+            watchLevel = true;
+            return value.empty();
+        }
+        if (name == "clients") { return parseNumber(value, loadTestClients) && loadTestClients > 0; }
+        if (name == "realtime") {
+            realtimeTicksPerSecond = cDefaultTicksPerSecond;
+            return value.empty() || (parseNumber(value, *realtimeTicksPerSecond)
+                && *realtimeTicksPerSecond > 0 && *realtimeTicksPerSecond <= cMaximumTicksPerSecond);
+        }
+        if (name == "terminal") {
+            if (value == "ansi") { consoleEncoding = ConsoleEncoding::Ansi; return true; }
+            if (value == "256") { consoleEncoding = ConsoleEncoding::Ansi256; return true; }
+            if (value == "truecolor") { consoleEncoding = ConsoleEncoding::TrueColor; return true; }
+            if (value == "ascii") { consoleEncoding = ConsoleEncoding::Ascii; return true; }
+            return false;
+        }
+        if (name == "fps") { return parseNumber(value, replayFramesPerSecond) && replayFramesPerSecond > 0; }
+        if (name == "profile") {
+            if (!cProfilingEnabled) {
+                std::cerr << "This build has no profiling support, configure it with ROBOT_ESCAPE_PROFILING=ON.\n";
+                exit(1);
+            }
+            profilePath = value.empty() ? std::filesystem::path{cDefaultProfilePath} : std::filesystem::path{value};
+            Profiler::isEnabled = true;
+            return true;
+        }
+        if (name == "policy") {
+            if (value == "random") { simulationPolicy = PlayerPolicy::Random; return true; }
+            if (value == "greedy") { simulationPolicy = PlayerPolicy::GreedyToExit; return true; }
+            if (value == "bfs") { simulationPolicy = PlayerPolicy::BfsToExit; return true; }
+        }
+        if (name == "backend") {
+            if (value == "auto") { simulationBackend = SimulationBackend::Automatic; return true; }
+            if (value == "field") { simulationBackend = SimulationBackend::Field; return true; }
+            if (value == "bitboard") { simulationBackend = SimulationBackend::Bitboard; return true; }
+        }
+        if (name == "heatmap") {
+            heatmapPrefix = std::filesystem::path{value};
+            return !value.empty();
+        }
+        if (name == "show-heatmap") {
+            const auto layer = std::ranges::find(cHeatmapLayerNames, value);
+            if (layer == cHeatmapLayerNames.end()) { return false; }
+            shownHeatmapLayer = static_cast<HeatmapLayer>(layer - cHeatmapLayerNames.begin());
+            return true;
+        }
+        return false;
+    }
 
     void parseArgs(int argc, char **argv) {
-        if (argc < 2) {
-            std::cout << "Usage: " << argv[0] << " <config-file>\n";
-            exit(1);
+        auto args = std::vector<std::string_view>(argv + 1, argv + argc);
+        if (!args.empty() && args.front() == "simulate") {
+            command = Command::Simulate;
+            args.erase(args.begin());
+        } else if (!args.empty() && args.front() == "compile") {
+            command = Command::Compile;
+            args.erase(args.begin());
+        } else if (!args.empty() && args.front() == "replay") {
+            command = Command::Replay;
+            args.erase(args.begin());
+        } else if (!args.empty() && args.front() == "solve") {
+            command = Command::Solve;
+            args.erase(args.begin());
+        } else if (!args.empty() && args.front() == "generate") {
+            command = Command::Generate;
+            args.erase(args.begin());
+        } else if (!args.empty() && args.front() == "serve") {
+            command = Command::Serve;
+            args.erase(args.begin());
+        } else if (!args.empty() && args.front() == "load-test") {
+            command = Command::LoadTest;
+            args.erase(args.begin());
+        }
+        std::vector<std::string_view> positionalArgs;
+        for (auto arg : args) {
+            if (!arg.starts_with("--")) {
+                positionalArgs.push_back(arg);
+                continue;
+            }
+            arg.remove_prefix(2);
+            const auto separator = arg.find('=');
+            const auto name = arg.substr(0, separator);
+            const auto value = separator == std::string_view::npos ? std::string_view{} : arg.substr(separator + 1);
+            if (!parseOption(name, value)) {
+                std::cerr << std::format("Invalid option '--{}'.\n", arg);
+                exitWithUsage(argv[0]);
+            }
         }
-        configPath = std::filesystem::path{argv[1]};
+        const auto hasOutput = (command == Command::Compile || command == Command::Generate);
+        const auto expectedArgs = (hasOutput || command == Command::Replay ? 2U : 1U);
+        const auto hasHeatmap = heatmapPrefix || shownHeatmapLayer;
+        if (positionalArgs.size() != expectedArgs || (watchLevel && command != Command::Serve)
+            || (hasHeatmap && command != Command::Simulate)) { exitWithUsage(argv[0]); }
+        configPath = std::filesystem::path{positionalArgs.front()};
+        if (hasOutput) { outputPath = std::filesystem::path{positionalArgs.back()}; }
+        if (command == Command::Replay) { replayPath = std::filesystem::path{positionalArgs.back()}; }
+    }
+
+    [[nodiscard]] auto isLevelFile() const -> bool {
+        return command != Command::Compile && command != Command::Generate && LevelFile::hasSignature(configPath);
     }
 
     void readConfiguration() {
+        if (isLevelFile()) { return; }
+        const auto profileScope = ProfileScope{ProfilePoint::ReadConfiguration};
         try {
             Parser parser;
             const auto source = Source::fromFile(configPath);
@@ -42,28 +250,25 @@ struct Application {
         }
     }
 
-    [[noreturn]] static void exitWithErrorInValue(const ValuePtr &value, const std::string &message) {
-        std::cerr << message
-            << " For value '"
-            << value->namePath().toText().toCharString()
-            << "' at "
-            << value->location().toText().toCharString();
-        exit(1);
+    [[noreturn]] static void throwErrorInValue(const ValuePtr &value, const std::string &message) {
+        throw std::runtime_error{message
+            + " For value '" + value->namePath().toText().toCharString()
+            + "' at " + value->location().toText().toCharString()};
     }
 
     [[nodiscard]] static auto rectFromSection(const ValuePtr &value) -> Rectangle {
         Rectangle result;
         if (value->hasValue(u8"rectangle")) {
             const auto rectList = value->getListOrThrow<int>(u8"rectangle");
-            if (rectList.size() != 4) { exitWithErrorInValue(value, "Rectangle must have exactly four elements."); }
+            if (rectList.size() != 4) { throwErrorInValue(value, "Rectangle must have exactly four elements."); }
             result = Rectangle(rectList[0], rectList[1], rectList[2], rectList[3]);
         } else if (value->hasValue(u8"position") != value->hasValue(u8"size")) {
-            exitWithErrorInValue(value, "Only 'position' or 'size' is not allowed.");
+            throwErrorInValue(value, "Only 'position' or 'size' is not allowed.");
         } else if (value->hasValue(u8"position") && value->hasValue(u8"size")) {
             auto posList = value->getListOrThrow<int>(u8"position");
-            if (posList.size() != 2) { exitWithErrorInValue(value, "Position must have exactly two elements."); }
+            if (posList.size() != 2) { throwErrorInValue(value, "Position must have exactly two elements."); }
             auto sizeList = value->getListOrThrow<int>(u8"size");
-            if (sizeList.size() != 2) { exitWithErrorInValue(value, "Size must have exactly two elements."); }
+            if (sizeList.size() != 2) { throwErrorInValue(value, "Size must have exactly two elements."); }
             result = Rectangle(Position{posList[0], posList[1]}, Size(sizeList[0], sizeList[1]));
         } else {
             result = Rectangle{value->getOrThrow<int>(u8"x"), value->getOrThrow<int>(u8"y"),
@@ -72,63 +277,666 @@ struct Application {
         return result;
     }
 
-    [[nodiscard]] auto buildWorld() const -> World {
+    static void validateField(const Field &field) {
+        if (!Field::cMinimumSize.fitsInto(field.rect.size)) {
+            std::cerr << std::format("Field size must be at least {}x{}\n", Field::cMinimumSize.width, Field::cMinimumSize.height);
+            exit(1);
+        }
+        if (!field.rect.size.fitsInto(Field::cMaximumSize)) {
+            std::cerr << std::format("Field size must be at most {}x{}\n", Field::cMaximumSize.width, Field::cMaximumSize.height);
+            exit(1);
+        }
+    }
+
+    [[nodiscard]] auto buildField() const -> Field {
+        const auto profileScope = ProfileScope{ProfilePoint::BuildField};
+        if (isLevelFile()) {
+            try {
+                auto field = LevelFile::read(configPath);
+                validateField(field);
+                return field;
+            } catch (const std::runtime_error &error) {
+                std::cerr << error.what() << "\n";
+                exit(1);
+            }
+        }
+        try {
+            Field field;
+            field.addRooms(roomRectsFromConfiguration(config));
+            validateField(field);
+            return field;
+        } catch (const Error &error) {
+            std::cerr << error.toText().toCharString() << "\n";
+            exit(1);
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+    }
+
+    /// Exit if the exit, the player and `count` robots do not always fit on the field, see `World::canAlwaysPopulate`.
+    static void validateRobotCount(const Field &field, int count) {
+        if (!World::canAlwaysPopulate(field.walkableCellCount(), count)) {
+            std::cerr << std::format("The field has {} walkable cells, this is not enough room for the exit, the player and {} robots.\n",
+                field.walkableCellCount(), count);
+            exit(1);
+        }
+    }
+
+    /// The field of the level, with enough room for the robots of the configuration.
+    [[nodiscard]] auto buildPlayableField() const -> Field {
+        auto field = buildField();
+        validateRobotCount(field, robotCount());
+        return field;
+    }
+
+    [[nodiscard]] static auto roomRectsFromConfiguration(const DocumentPtr &document) -> std::vector<Rectangle> {
+        std::vector<Rectangle> roomRects;
+        for (const auto &roomValue : *document->getSectionListOrThrow("field.room")) {
+            roomRects.push_back(rectFromSection(roomValue));
+        }
+        return roomRects;
+    }
+
+    // Reads the level again after its file was changed, in the thread of the watcher. Only the tiles
+    // near the rooms that were added or removed are built again. If the new level is not valid, it
+    // is reported, and the current level stays.
+    void reloadLevel(SharedLevel &level, int levelRobotCount) const {
+        const auto startTime = std::chrono::steady_clock::now();
+        Field field;
+        std::size_t builtTileCount{};
         try {
-            World world;
-            for (const auto &roomValue : *config->getSectionListOrThrow("field.room")) {
-                const auto roomRect = rectFromSection(roomValue);
-                world.field.addRoom(roomRect);
+            if (LevelFile::hasSignature(configPath)) {
+                field = LevelFile::read(configPath);
+                builtTileCount = field.tileIndices.size();
+            } else {
+                Parser parser;
+                for (const auto &roomRect : roomRectsFromConfiguration(parser.parseOrThrow(Source::fromFile(configPath)))) {
+                    field.rooms.emplace_back(Room{roomRect});
+                }
+                builtTileCount = field.updateFrom(*level.current());
             }
-            if (!cMinimumFieldSize.fitsInto(world.field.rect.size)) {
-                std::cerr << std::format("Field size must be at least {}x{}\n", cMinimumFieldSize.width, cMinimumFieldSize.height);
+        } catch (const Error &error) {
+            std::cerr << std::format("The level was not reloaded: {}\n", error.toText().toCharString());
+            return;
+        } catch (const std::runtime_error &error) {
+            std::cerr << std::format("The level was not reloaded: {}\n", error.what());
+            return;
+        }
+        switch (LevelGenerator::check(field, levelRobotCount)) {
+        case LevelCheck::Valid: break;
+        case LevelCheck::TooSmall: std::cerr << "The level was not reloaded: the field is too small.\n"; return;
+        case LevelCheck::TooLarge: std::cerr << "The level was not reloaded: the field is too large.\n"; return;
+        case LevelCheck::TooCrowded: std::cerr << "The level was not reloaded: there is not enough room for the robots.\n"; return;
+        }
+        const auto rooms = field.rooms.size();
+        const auto tiles = field.tileIndices.size();
+        level.publish(std::move(field));
+        std::cout << std::format("Reloaded the level with {} rooms, built {} of {} tiles in {:.1f} ms. New games use it.\n",
+            rooms, builtTileCount, tiles,
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    [[nodiscard]] auto gameSeed() const -> std::uint64_t {
+        return seed.value_or(Random::seedFromEntropy());
+    }
+
+    [[nodiscard]] auto robotStrategy() const -> RobotStrategy {
+        if (!config) { return RobotStrategy::Greedy; }
+        const auto name = config->getOr<String>(u8"robots.strategy", String{u8"greedy"}).toCharString();
+        if (name == "greedy") { return RobotStrategy::Greedy; }
+        if (name == "flow_field") { return RobotStrategy::FlowField; }
+        std::cerr << std::format("Unknown robot strategy '{}', expected 'greedy' or 'flow_field'.\n", name);
+        exit(1);
+    }
+
+    [[nodiscard]] auto robotCount() const -> int {
+        if (!config) { return cDefaultRobotCount; }
+        const auto count = config->getOr<int>(u8"robots.count", cDefaultRobotCount);
+        if (count < 0 || count > cMaximumRobotCount) {
+            std::cerr << std::format("The robot count must be between 0 and {}.\n", cMaximumRobotCount);
+            exit(1);
+        }
+        return count;
+    }
+
+    void renderLogic(const Logic &logic) {
+        canvas.clear();
+        logic.render(canvas);
+        ConsoleRenderer::writeToConsole(renderer.render(canvas));
+    }
+
+    [[nodiscard]] auto openReplayWriter(const Field &field, std::uint64_t runSeed) const -> std::unique_ptr<ReplayWriter> {
+        if (!recordPath) { return {}; }
+        auto header = ReplayFileHeader{};
+        header.seed = runSeed;
+        header.levelHash = ReplayFile::levelHash(field);
+        header.robotCount = static_cast<uint32_t>(robotCount());
+        header.robotStrategy = static_cast<uint32_t>(robotStrategy());
+        try {
+            return std::make_unique<ReplayWriter>(*recordPath, header);
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+    }
+
+    static void finishReplayWriter(ReplayWriter &replayWriter) {
+        try {
+            replayWriter.finish();
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+    }
+
+    static void printStatistics(const SimulationStatistics &statistics) {
+        std::cout << std::format("Player won: {:>10} ({:.1f}%)\n", statistics.playerWins, statistics.percentOfGames(statistics.playerWins));
+        std::cout << std::format("Robots won: {:>10} ({:.1f}%)\n", statistics.robotWins, statistics.percentOfGames(statistics.robotWins));
+        std::cout << std::format("Timed out:  {:>10} ({:.1f}%)\n", statistics.timeouts, statistics.percentOfGames(statistics.timeouts));
+        if (statistics.games > 0) {
+            std::cout << std::format("Turns/game: avg {:.1f}, min {}, max {}\n",
+                statistics.averageTurns(), statistics.minTurns, statistics.maxTurns);
+        }
+    }
+
+    void runSimulation() {
+        const auto runSeed = gameSeed();
+        auto field = buildPlayableField();
+        if (simulationBackend == SimulationBackend::Bitboard && !BitboardLogic::fits(field)) {
+            std::cerr << std::format("The bitboard backend supports fields of up to {}x{} cells.\n",
+                BitPlane::cSize, BitPlane::cSize);
+            exit(1);
+        }
+        const auto replayWriter = openReplayWriter(field, runSeed);
+        auto heatmap = std::optional<Heatmap>{};
+        if (heatmapPrefix || shownHeatmapLayer) {
+            // Every thread counts into its own heatmap, and adds it to the totals.
+            const auto heatmapMemorySize = Heatmap::memorySize(field) + HeatmapShard::memorySize(field) * simulationThreads;
+            if (heatmapMemorySize > Heatmap::cMaximumMemorySize) {
+                std::cerr << std::format("The heatmaps of this level need {} MB with {} threads, at most {} MB are allowed."
+                    " Use fewer threads.\n", heatmapMemorySize >> 20U, simulationThreads, Heatmap::cMaximumMemorySize >> 20U);
                 exit(1);
             }
-            if (!world.field.rect.size.fitsInto(cMaximumFieldSize)) {
-                std::cerr << std::format("Field size must be at most {}x{}\n", cMaximumFieldSize.width, cMaximumFieldSize.height);
+            heatmap.emplace();
+        }
+        const auto simulation = Simulation{
+            .field = std::move(field),
+            .robotCount = robotCount(),
+            .robotStrategy = robotStrategy(),
+            .playerPolicy = simulationPolicy,
+            .maxTurns = maxTurns.value_or(cDefaultSimulationTurns),
+            .replayWriter = replayWriter.get(),
+            .heatmap = heatmap ? &*heatmap : nullptr,
+            .backend = simulationBackend,
+        };
+        const auto statistics = simulation.run(simulationGames, runSeed, simulationThreads);
+        if (replayWriter) { finishReplayWriter(*replayWriter); }
+        if (heatmapPrefix) { writeHeatmap(*heatmap, simulation.field); }
+        if (shownHeatmapLayer) { showHeatmap(*heatmap, simulation.field, *shownHeatmapLayer); }
+        std::cout << std::format("Simulated {} games in {:.3f} s ({:.0f} games/s, {} threads, {} backend, seed {})\n",
+            statistics.games, statistics.seconds, statistics.gamesPerSecond(), simulationThreads,
+            simulation.usesBitboards() ? "bitboard" : "field", runSeed);
+        printStatistics(statistics);
+    }
+
+    // Writes all layers to `<prefix>.csv`, and each layer to `<prefix>-<layer>.pgm`.
+    void writeHeatmap(const Heatmap &heatmap, const Field &field) const {
+        try {
+            heatmap.writeCsv(field, std::filesystem::path{heatmapPrefix->string() + ".csv"});
+            for (std::size_t i = 0; i < cHeatmapLayerCount; ++i) {
+                heatmap.writePgm(static_cast<HeatmapLayer>(i),
+                    std::filesystem::path{std::format("{}-{}.pgm", heatmapPrefix->string(), cHeatmapLayerNames[i])});
+            }
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+    }
+
+    // Draws one layer of the heatmap over the level; the statistics are printed below it.
+    void showHeatmap(const Heatmap &heatmap, const Field &field, HeatmapLayer layer) {
+        prepareScreen(field);
+        std::cout << std::format("\x1b[{};1HHeatmap of the {} layer, the highest count is {}.\n",
+            cCanvasScreenRow - 1, cHeatmapLayerNames[static_cast<std::size_t>(layer)], heatmap.maximum(layer));
+        canvas.setTopLeft(canvas.size.center() - field.rect.center());
+        field.render(canvas);
+        heatmap.render(canvas, layer);
+        ConsoleRenderer::writeToConsole(renderer.render(canvas));
+    }
+
+    // Shows the games one after the other, at `replayFramesPerSecond`.
+    void showReplay(const ReplayFile &replay, const Field &field) {
+        auto logic = Logic{World{field}, replay.robotStrategy()};
+        prepareScreen(field);
+        const auto frameTime = std::chrono::microseconds{1000000 / replayFramesPerSecond};
+        auto game = ReplayGame{};
+        for (std::size_t offset = 0; offset < replay.records().size();) {
+            replay.readGame(offset, game);
+            ReplayFile::startGame(logic, replay.header.seed, game.index, static_cast<int>(replay.header.robotCount));
+            for (std::size_t turn = 0; turn <= game.moves.size() && logic.gameState() == GameState::Running; ++turn) {
+                if (turn > 0) { logic.advance(ReplayGame::inputFromMove(game.moves[turn - 1])); }
+                renderLogic(logic);
+                std::cout << std::format("\x1b[{};1H\x1b[2KGame {}, turn {} of {}\n",
+                    cCanvasScreenRow - 1, game.index, turn, game.moves.size());
+                std::this_thread::sleep_for(frameTime);
+            }
+        }
+        std::cout << std::format("\x1b[{};1H", cCanvasScreenRow + canvas.size.height);
+    }
+
+    // Replays all games without rendering, on all threads, and compares the results with the recording.
+    void runReplay() {
+        try {
+            const auto replay = ReplayFile{replayPath};
+            const auto field = buildField();
+            if (ReplayFile::levelHash(field) != replay.header.levelHash) {
+                std::cerr << "The replay was recorded on a different level.\n";
                 exit(1);
             }
-            world.addExitAtRandomPosition();
-            world.setPlayerToRandomPosition();
-            for (int i = 0; i < 3; ++i) {
-                world.addRobotAtRandomPosition();
+            if (replay.header.robotCount > cMaximumRobotCount) {
+                std::cerr << std::format("The replay has more than {} robots.\n", cMaximumRobotCount);
+                exit(1);
+            }
+            validateRobotCount(field, static_cast<int>(replay.header.robotCount));
+            if (replayFramesPerSecond > 0) {
+                showReplay(replay, field);
+                return;
+            }
+            const auto startTime = std::chrono::steady_clock::now();
+            const auto gameOffsets = replay.gameOffsets();
+            auto pool = WorkStealingPool{simulationThreads};
+            auto shards = std::vector<SimulationStatistics>(pool.threadCount);
+            auto mismatchShards = std::vector<std::uint64_t>(pool.threadCount);
+            pool.run(gameOffsets.size(), [&](WorkStealingPool::Worker &worker) {
+                auto logic = Logic{World{field}, replay.robotStrategy()};
+                auto game = ReplayGame{};
+                std::uint64_t gameIndex{};
+                while (worker.next(gameIndex)) {
+                    auto offset = gameOffsets[gameIndex];
+                    replay.readGame(offset, game);
+                    const auto state = replay.replayGame(logic, game);
+                    if (state != game.finalState) { ++mismatchShards[worker.index]; }
+                    shards[worker.index].addGame(state.value_or(GameState::Running), static_cast<int>(game.moves.size()));
+                }
+            });
+            SimulationStatistics statistics;
+            std::uint64_t mismatches{};
+            for (unsigned i = 0; i < pool.threadCount; ++i) {
+                statistics.merge(shards[i]);
+                mismatches += mismatchShards[i];
+            }
+            statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            std::cout << std::format("Replayed {} games in {:.3f} s ({:.0f} games/s, {} threads, seed {})\n",
+                statistics.games, statistics.seconds, statistics.gamesPerSecond(), pool.threadCount, replay.header.seed);
+            printStatistics(statistics);
+            if (mismatches > 0) {
+                std::cerr << std::format("{} games did not end as recorded.\n", mismatches);
+                exit(1);
             }
-            return world;
+            std::cout << "All games ended as recorded.\n";
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+    }
+
+    void compileLevel() {
+        const auto field = buildPlayableField();
+        try {
+            LevelFile::write(field, outputPath);
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+        std::cout << std::format("Compiled {} rooms ({}x{} cells) into '{}'.\n",
+            field.rooms.size(), field.rect.size.width, field.rect.size.height, outputPath.string());
+    }
+
+    // The optional `[generator]` section: `size`, and the ranges `rooms` and `room_size`, each as two numbers.
+    [[nodiscard]] auto generatorSettings() const -> LevelGeneratorSettings {
+        auto settings = LevelGeneratorSettings{.robotCount = robotCount(), .robotStrategy = robotStrategy()};
+        try {
+            auto readPair = [&](const char8_t *namePath, int &first, int &second) {
+                if (!config->hasValue(namePath)) { return; }
+                const auto values = config->getListOrThrow<int>(namePath);
+                if (values.size() != 2) {
+                    std::cerr << "The values in the 'generator' section must have exactly two elements.\n";
+                    exit(1);
+                }
+                first = values[0];
+                second = values[1];
+            };
+            readPair(u8"generator.size", settings.bounds.width, settings.bounds.height);
+            readPair(u8"generator.rooms", settings.minimumRoomCount, settings.maximumRoomCount);
+            readPair(u8"generator.room_size", settings.minimumRoomSize, settings.maximumRoomSize);
         } catch (const Error &error) {
             std::cerr << error.toText().toCharString() << "\n";
             exit(1);
         }
+        if (!Field::cMinimumSize.fitsInto(settings.bounds) || !settings.bounds.fitsInto(Field::cMaximumSize)) {
+            std::cerr << std::format("The generator size must be between {}x{} and {}x{}.\n", Field::cMinimumSize.width,
+                Field::cMinimumSize.height, Field::cMaximumSize.width, Field::cMaximumSize.height);
+            exit(1);
+        }
+        if (settings.minimumRoomCount < 1 || settings.minimumRoomCount > settings.maximumRoomCount
+            || settings.maximumRoomCount > LevelGenerator::cMaximumRoomCount) {
+            std::cerr << std::format("The generator rooms must be a range between 1 and {}.\n", LevelGenerator::cMaximumRoomCount);
+            exit(1);
+        }
+        if (settings.minimumRoomSize < 1 || settings.minimumRoomSize > settings.maximumRoomSize
+            || settings.minimumRoomSize > std::min(settings.bounds.width, settings.bounds.height)) {
+            std::cerr << "The generator room size must be a range between 1 and the shorter side of the size.\n";
+            exit(1);
+        }
+        return settings;
     }
 
-    void renderLogic(const Logic &logic) {
-        auto canvasSize = logic.world.field.rect.padded(2, 1).size.componentMax(cMinimumCanvasSize);
-        Canvas canvas{canvasSize};
-        logic.render(canvas);
-        canvas.renderToConsole();
+    // Generates the levels on all threads. Level `n` only depends on the seed, not on the threads.
+    void generateLevels() {
+        const auto generator = LevelGenerator{generatorSettings()};
+        const auto runSeed = gameSeed();
+        std::error_code errorCode;
+        std::filesystem::create_directories(outputPath, errorCode);
+        if (errorCode) {
+            std::cerr << std::format("Could not create the directory '{}': {}\n", outputPath.string(), errorCode.message());
+            exit(1);
+        }
+        struct alignas(64) GeneratorShard {
+            std::uint64_t rejectedLayouts{};
+            std::uint64_t missingLevels{};
+            std::string error; // the first error while writing a level.
+        };
+        const auto startTime = std::chrono::steady_clock::now();
+        auto pool = WorkStealingPool{simulationThreads, 16};
+        auto shards = std::vector<GeneratorShard>(pool.threadCount);
+        pool.run(generatorLevels, [&](WorkStealingPool::Worker &worker) {
+            auto &shard = shards[worker.index];
+            std::uint64_t levelIndex{};
+            while (worker.next(levelIndex)) {
+                auto random = Random{runSeed}.stream(levelIndex);
+                const auto field = generator.generate(random, shard.rejectedLayouts);
+                if (!field) {
+                    ++shard.missingLevels;
+                    continue;
+                }
+                const auto isCompiled = (generatorFormat == LevelFormat::Compiled);
+                const auto path = outputPath / std::format("level-{:06}.{}", levelIndex + 1, isCompiled ? "bin" : "elcl");
+                try {
+                    if (isCompiled) {
+                        LevelFile::write(*field, path);
+                    } else {
+                        generator.writeConfiguration(*field, path);
+                    }
+                } catch (const std::runtime_error &error) {
+                    ++shard.missingLevels;
+                    if (shard.error.empty()) { shard.error = error.what(); }
+                }
+            }
+        });
+        std::uint64_t rejectedLayouts{};
+        std::uint64_t missingLevels{};
+        std::string error;
+        for (const auto &shard : shards) {
+            rejectedLayouts += shard.rejectedLayouts;
+            missingLevels += shard.missingLevels;
+            if (error.empty()) { error = shard.error; }
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        const auto levelCount = generatorLevels - missingLevels;
+        std::cout << std::format("Generated {} levels in {:.3f} s ({:.0f} levels/s, {} threads, seed {}), {} layouts rejected.\n",
+            levelCount, seconds, static_cast<double>(levelCount) / std::max(seconds, 1e-9), pool.threadCount, runSeed,
+            rejectedLayouts);
+        if (!error.empty()) {
+            std::cerr << error << "\n";
+            exit(1);
+        }
+        if (missingLevels > 0) {
+            std::cerr << std::format("{} levels were not generated: the generator size leaves too little room for {} robots.\n",
+                missingLevels, generator.settings.robotCount);
+            exit(1);
+        }
     }
 
-    void run() {
-        auto initialWorld = buildWorld();
+    [[nodiscard]] static auto inputName(PlayerInput input) -> char {
+        return GameProtocol::cMoveCommands[ReplayGame::moveFromInput(input)];
+    }
+
+    // Solves game 0 of the seed, which is the game that is played with the same seed.
+    void solveGame() {
+        auto logic = Logic{World{buildPlayableField()}, robotStrategy()};
+        const auto solveSeed = gameSeed();
+        ReplayFile::startGame(logic, solveSeed, 0, robotCount());
+        const auto turnLimit = maxTurns.value_or(Solver::cDefaultMaxTurns);
+        SolverResult result;
+        try {
+            auto solver = Solver{logic.world, logic.robotLogic.strategy, turnLimit};
+            result = solver.solve(logic);
+        } catch (const std::logic_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+        std::cout << std::format("Searched {} states in {:.3f} s, {} stored using {:.1f} MiB (seed {}).\n",
+            result.visitedStates, result.seconds, result.storedStates,
+            static_cast<double>(result.memorySize) / (1024.0 * 1024.0), solveSeed);
+        if (!result.canWin) {
+            std::cout << std::format("The player cannot force a win within {} turns.\n", turnLimit);
+            return;
+        }
+        std::cout << std::format("The player can force a win in {} turns.\n", result.turns);
+        std::string line;
+        for (const auto input : result.inputs) {
+            line += inputName(input);
+        }
+        std::cout << std::format("Winning moves: {}\n", line);
+    }
+
+    // Hosts games until SIGINT or SIGTERM, then prints what was played.
+    void serveGames() {
+        auto server = GameServer{
+            .field = buildPlayableField(),
+            .robotCount = robotCount(),
+            .robotStrategy = robotStrategy(),
+            .seed = gameSeed(),
+            .address = serverAddress,
+            .threadCount = simulationThreads,
+        };
+        server.canvasSize = canvasSize(server.field);
+        std::cout << std::format("Serving games on {} with {} threads (seed {}). Stop with Ctrl+C.\n",
+            serverAddress.text(), simulationThreads, server.seed);
+        ServerStatistics statistics;
+        std::unique_ptr<FileWatcher> watcher;
+        try {
+            if (watchLevel) {
+                server.level.publish(server.field);
+                watcher = std::make_unique<FileWatcher>(configPath, [&] { reloadLevel(server.level, server.robotCount); });
+                std::cout << std::format("Watching '{}', changes of the level are used for new games.\n", configPath.string());
+            }
+            statistics = server.run();
+        } catch (const std::runtime_error &error) { // includes the `std::system_error` of the sockets.
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+        watcher.reset();
+        std::cout << std::format("Served {} connections, {} games ({} won by the player), {} moves, {:.1f} MiB sent.\n",
+            statistics.connections, statistics.games, statistics.playerWins, statistics.moves,
+            static_cast<double>(statistics.bytesSent) / (1024.0 * 1024.0));
+        if (statistics.sessionSlots > 0) {
+            std::cout << std::format("Session slots: {}, {} bytes each.\n",
+                statistics.sessionSlots, statistics.sessionMemory / statistics.sessionSlots);
+        }
+    }
+
+    void runLoadTest() {
+        auto loadTest = LoadTest{
+            .field = buildField(),
+            .address = serverAddress,
+            .clientCount = loadTestClients,
+            .games = simulationGames,
+            .playerPolicy = simulationPolicy,
+            .maxTurns = maxTurns.value_or(cDefaultSimulationTurns),
+        };
+        const auto startTime = std::chrono::steady_clock::now();
+        try {
+            loadTest.run();
+        } catch (const std::runtime_error &error) { // includes the `std::system_error` of the sockets.
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        const auto &latency = loadTest.moveLatency;
+        std::cout << std::format("Played {} games with {} clients in {:.3f} s ({:.0f} moves/s)\n",
+            loadTest.statistics.games, loadTestClients, seconds, static_cast<double>(loadTest.moves) / seconds);
+        if (latency.calls > 0) {
+            std::cout << std::format("Move latency: p50 {:.1f} us, p99 {:.1f} us, max {:.1f} us\n",
+                static_cast<double>(latency.percentile(0.5)) / 1000.0, static_cast<double>(latency.percentile(0.99)) / 1000.0,
+                static_cast<double>(latency.maxNanoseconds) / 1000.0);
+        }
+        printStatistics(loadTest.statistics);
+    }
+
+    [[nodiscard]] static auto canvasSize(const Field &field) noexcept -> Size {
+        return field.rect.padded(2, 1).size.componentMax(cMinimumCanvasSize).componentMin(cMaximumCanvasSize);
+    }
+
+    void prepareScreen(const Field &field) {
+        canvas = Canvas{canvasSize(field)};
+        renderer.originRow = cCanvasScreenRow;
+        renderer.setEncoding(consoleEncoding);
+        std::cout << "\x1b[H\x1b[2J";
         std::cout << "----------------------------==[ ROBOT ESCAPE ]==-----------------------------\n";
+    }
+
+    /// The goal of the game, with the glyphs of the console encoding.
+    [[nodiscard]] auto legend() const -> std::string {
+        const auto &glyphs = consoleEncoding == ConsoleEncoding::Ascii ? AsciiEncoding::cGlyphs : UnicodeGlyphs::cGlyphs;
+        auto glyph = [&](Block block) { return glyphs[static_cast<std::size_t>(block)]; };
+        return std::format("You ({}) must run to the exit ({}) before any robot ({}) catches you.\n\n",
+            glyph(Block::Player), glyph(Block::Exit), glyph(Block::Robot));
+    }
+
+    // Plays one game in real time, see `RealtimeGame`.
+    void playRealtime() {
+        if (recordPath) {
+            std::cerr << "Games in real time can not be recorded, a replay has no turns without a move.\n";
+            exit(1);
+        }
+        auto logic = Logic{World{buildPlayableField()}, robotStrategy()};
+        ReplayFile::startGame(logic, gameSeed(), 0, robotCount());
+        std::optional<RawTerminal> terminal;
+        try {
+            terminal.emplace();
+        } catch (const std::runtime_error &error) {
+            std::cerr << error.what() << "\n";
+            exit(1);
+        }
+        prepareScreen(logic.world.field);
+        std::cout << std::format("Welcome to Robot Escape! The robots move {} times per second.\n", *realtimeTicksPerSecond);
+        std::cout << legend();
+        std::cout.flush();
+        auto game = RealtimeGame{
+            .logic = logic,
+            .renderer = renderer,
+            .canvasSize = canvas.size,
+            .tickTime = std::chrono::steady_clock::duration{std::chrono::seconds{1}} / *realtimeTicksPerSecond,
+        };
+        const auto state = game.run(*terminal);
+        terminal.reset();
+        switch (state) {
+        case GameState::Running: std::cout << "Goodbye!\n"; break;
+        case GameState::PlayerWon: std::cout << "You won!\n"; break;
+        case GameState::RobotsWon: std::cout << "You lost!\n"; break;
+        }
+        const auto &latency = game.inputLatency;
+        if (latency.calls > 0) {
+            std::cout << std::format("Key to frame latency: p50 {:.1f} us, p99 {:.1f} us, max {:.1f} us ({} turns, {} frames dropped)\n",
+                static_cast<double>(latency.percentile(0.5)) / 1000.0, static_cast<double>(latency.percentile(0.99)) / 1000.0,
+                static_cast<double>(latency.maxNanoseconds) / 1000.0, game.turns, game.droppedFrames);
+        }
+    }
+
+    void play() {
+        if (realtimeTicksPerSecond) {
+            playRealtime();
+            return;
+        }
+        auto logic = Logic{World{buildPlayableField()}, robotStrategy()};
+        const auto playSeed = gameSeed();
+        ReplayFile::startGame(logic, playSeed, 0, robotCount());
+        const auto replayWriter = openReplayWriter(logic.world.field, playSeed);
+        auto replayGame = ReplayGame{};
+        auto recordGame = [&](GameState finalState) {
+            if (!replayWriter) { return; }
+            replayGame.finalState = finalState;
+            auto recorder = ReplayRecorder{replayWriter.get()};
+            recorder.addGame(replayGame);
+            recorder.flush();
+            finishReplayWriter(*replayWriter);
+        };
+        prepareScreen(logic.world.field);
         std::cout << "Welcome to Robot Escape!\n";
-        std::cout << "You (☻) must run to the exit (⚑) before any robot (♟) catches you.\n\n";
-        auto logic = Logic{std::move(initialWorld)};
+        std::cout << legend();
         renderLogic(logic);
         auto state = logic.gameState();
+        std::vector<GameSnapshot> history; // the state before each move, for undo.
         while (state == GameState::Running) {
             auto playerInput = inputFromConsole();
             if (playerInput == cQuitInput) {
+                recordGame(state);
                 std::cout << "Goodbye!\n";
                 return;
             }
-            logic.advance(playerInput);
+            if (playerInput == cUndoInput) {
+                if (replayGame.moves.empty()) {
+                    std::cout << "There is no move to undo.\n";
+                    continue;
+                }
+                replayGame.moves.pop_back();
+                logic.restore(history[replayGame.moves.size()]);
+                renderLogic(logic);
+                continue;
+            }
+            if (history.size() == replayGame.moves.size()) { history.emplace_back(); }
+            logic.saveSnapshot(history[replayGame.moves.size()]);
+            replayGame.moves.push_back(ReplayGame::moveFromInput(playerInput));
+            const auto playerMoved = logic.advance(playerInput);
             renderLogic(logic);
+            if (!playerMoved) {
+                std::cout << "Could not move in this direction. You lost one move.\n";
+            }
             state = logic.gameState();
         }
+        recordGame(state);
         if (state == GameState::PlayerWon) {
             std::cout << "You won!\n";
         } else {
             std::cout << "You lost!\n";
         }
     }
+
+    void writeProfile() const {
+        const auto summary = Profiler::summary();
+        std::cout << Profiler::summaryAsText(summary);
+        auto file = std::ofstream{*profilePath};
+        file << Profiler::summaryAsJson(summary);
+        if (!file) {
+            std::cerr << std::format("Could not write the profile to '{}'.\n", profilePath->string());
+            exit(1);
+        }
+    }
+
+    void run() {
+        switch (command) {
+        case Command::Play: play(); break;
+        case Command::Simulate: runSimulation(); break;
+        case Command::Compile: compileLevel(); break;
+        case Command::Replay: runReplay(); break;
+        case Command::Solve: solveGame(); break;
+        case Command::Generate: generateLevels(); break;
+        case Command::Serve: serveGames(); break;
+        case Command::LoadTest: runLoadTest(); break;
+        }
+        if (profilePath) { writeProfile(); }
+    }
 };
 
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "Field.hpp"
+#include "Logic.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "World.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ROBOT_ESCAPE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+// One bit per cell of a field with at most 64x64 cells: bit `x` of row `y` is the cell at `x`, `y`
+// relative to the top left corner of the field. The rows above and below the field are kept
+// empty, so the neighbours of every row can be read without bounds checks.
+struct BitPlane {
+    constexpr static int cSize = 64;
+
+    alignas(32) std::array<uint64_t, cSize + 2> rows{}; // row `y` is at index `y + 1`.
+
+    [[nodiscard]] auto row(int y) const noexcept -> uint64_t { return rows[static_cast<std::size_t>(y + 1)]; }
+    [[nodiscard]] auto test(Position local) const noexcept -> bool { return ((row(local.y) >> local.x) & 1U) != 0; }
+    void set(Position local) noexcept { rows[static_cast<std::size_t>(local.y + 1)] |= uint64_t{1} << local.x; }
+    void reset(Position local) noexcept { rows[static_cast<std::size_t>(local.y + 1)] &= ~(uint64_t{1} << local.x); }
+    void clear() noexcept { rows.fill(0); }
+
+    /// The neighbours of `local` that are set, bit `i` for the neighbour at `cPosDelta4[i]`.
+    [[nodiscard]] auto neighbourMask(Position local) const noexcept -> unsigned {
+        const auto center = row(local.y);
+        return static_cast<unsigned>(((center >> local.x) >> 1) & 1U)
+            | static_cast<unsigned>((row(local.y + 1) >> local.x) & 1U) << 1
+            | static_cast<unsigned>(((center << 1) >> local.x) & 1U) << 2
+            | static_cast<unsigned>((row(local.y - 1) >> local.x) & 1U) << 3;
+    }
+};
+
+// The breadth-first sweep of the flow field, one distance per step, for all cells at once.
+// Instead of the distances, each step records the directions that lead back to the cells of
+// the previous step, as one plane per direction in the order of `cPosDelta4`.
+struct BitboardSweep {
+    BitPlane visited;
+    std::array<BitPlane, 2> frontiers;
+    std::array<BitPlane, cPosDelta4.size()> towardsOrigin;
+    int rowCount{}; // the number of rows to sweep, a multiple of four.
+
+    /// One step with the scalar kernel. @return `false` if no cell was added.
+    static auto stepScalar(const BitPlane &open, const BitPlane &frontier, BitPlane &next, BitPlane &visited,
+            std::array<BitPlane, cPosDelta4.size()> &towardsOrigin, int rowCount) noexcept -> bool {
+        uint64_t added = 0;
+        for (std::size_t i = 1; i <= static_cast<std::size_t>(rowCount); ++i) {
+            const auto center = frontier.rows[i];
+            const auto below = frontier.rows[i + 1];
+            const auto above = frontier.rows[i - 1];
+            const auto cells = ((center << 1) | (center >> 1) | below | above) & open.rows[i] & ~visited.rows[i];
+            next.rows[i] = cells;
+            visited.rows[i] |= cells;
+            towardsOrigin[0].rows[i] |= cells & (center >> 1);
+            towardsOrigin[1].rows[i] |= cells & below;
+            towardsOrigin[2].rows[i] |= cells & (center << 1);
+            towardsOrigin[3].rows[i] |= cells & above;
+            added |= cells;
+        }
+        return added != 0;
+    }
+
+#ifdef ROBOT_ESCAPE_AVX2_KERNELS
+    __attribute__((target("avx2")))
+    static auto load(const BitPlane &plane, std::size_t index) noexcept -> __m256i {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(plane.rows.data() + index));
+    }
+    __attribute__((target("avx2")))
+    static void store(BitPlane &plane, std::size_t index, __m256i value) noexcept {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(plane.rows.data() + index), value);
+    }
+
+    /// One step with the AVX2 kernel, four rows at once.
+    __attribute__((target("avx2")))
+    static auto stepAvx2(const BitPlane &open, const BitPlane &frontier, BitPlane &next, BitPlane &visited,
+            std::array<BitPlane, cPosDelta4.size()> &towardsOrigin, int rowCount) noexcept -> bool {
+        auto added = _mm256_setzero_si256();
+        for (std::size_t i = 1; i <= static_cast<std::size_t>(rowCount); i += 4) {
+            const auto center = load(frontier, i);
+            const auto below = load(frontier, i + 1);
+            const auto above = load(frontier, i - 1);
+            const auto fromEast = _mm256_srli_epi64(center, 1);
+            const auto fromWest = _mm256_slli_epi64(center, 1);
+            const auto reached = _mm256_or_si256(_mm256_or_si256(fromEast, fromWest), _mm256_or_si256(below, above));
+            const auto visitedRows = load(visited, i);
+            const auto cells = _mm256_andnot_si256(visitedRows, _mm256_and_si256(reached, load(open, i)));
+            store(next, i, cells);
+            store(visited, i, _mm256_or_si256(visitedRows, cells));
+            store(towardsOrigin[0], i, _mm256_or_si256(load(towardsOrigin[0], i), _mm256_and_si256(cells, fromEast)));
+            store(towardsOrigin[1], i, _mm256_or_si256(load(towardsOrigin[1], i), _mm256_and_si256(cells, below)));
+            store(towardsOrigin[2], i, _mm256_or_si256(load(towardsOrigin[2], i), _mm256_and_si256(cells, fromWest)));
+            store(towardsOrigin[3], i, _mm256_or_si256(load(towardsOrigin[3], i), _mm256_and_si256(cells, above)));
+            added = _mm256_or_si256(added, cells);
+        }
+        return _mm256_testz_si256(added, added) == 0;
+    }
+
+    inline static const bool hasAvx2 = __builtin_cpu_supports("avx2") != 0;
+#else
+    constexpr static bool hasAvx2 = false;
+#endif
+    inline static bool useAvx2 = hasAvx2; // can be cleared to compare the kernels.
+
+    /// Sweep from `origin` until all cells in `targets` are reached, or no more cells can be reached.
+    void run(const BitPlane &open, Position origin, const BitPlane &targets) noexcept {
+        visited.clear();
+        frontiers[0].clear();
+        frontiers[1].clear();
+        for (auto &plane : towardsOrigin) {
+            plane.clear();
+        }
+        visited.set(origin);
+        frontiers[0].set(origin);
+        for (std::size_t current = 0;; current ^= 1U) {
+            auto &frontier = frontiers[current];
+            auto &next = frontiers[current ^ 1U];
+#ifdef ROBOT_ESCAPE_AVX2_KERNELS
+            const auto added = useAvx2 ? stepAvx2(open, frontier, next, visited, towardsOrigin, rowCount)
+                : stepScalar(open, frontier, next, visited, towardsOrigin, rowCount);
+#else
+            const auto added = stepScalar(open, frontier, next, visited, towardsOrigin, rowCount);
+#endif
+            if (!added || isSubsetOf(targets, visited)) { return; }
+        }
+    }
+
+    [[nodiscard]] auto isSubsetOf(const BitPlane &plane, const BitPlane &other) const noexcept -> bool {
+        for (std::size_t i = 1; i <= static_cast<std::size_t>(rowCount); ++i) {
+            if ((plane.rows[i] & ~other.rows[i]) != 0) { return false; }
+        }
+        return true;
+    }
+};
+
+// A `Logic` for small fields that keeps the field, the robots and the exits as bit planes. The
+// robots that are blocked by each other and the flow field are bit tests, and the flow field is
+// swept for all cells at once, with AVX2 if the CPU has it. It plays exactly the same games as
+// `Logic` with the same random generators, but it does not keep `world.robotIndex` up to date.
+struct BitboardLogic {
+    World world; // `robotIndex` is only used to place the robots.
+    PlayerLogic playerLogic;
+    RobotStrategy strategy{RobotStrategy::Greedy};
+    Random random; // the robot decisions, like `RobotLogic::random`.
+    Position origin; // the top left corner of the field.
+    BitPlane room;
+    BitPlane robots;
+    BitPlane exits;
+    BitboardSweep sweep;
+
+    // The flow field of `RobotLogic` covers the whole field, so the sweep does not need a region.
+    static_assert(BitPlane::cSize <= RobotLogic::cFlowFieldRadius);
+
+    [[nodiscard]] static auto fits(const Field &field) noexcept -> bool {
+        return field.rect.size.fitsInto(Size{BitPlane::cSize, BitPlane::cSize});
+    }
+
+    explicit BitboardLogic(World &&initialWorld, RobotStrategy robotStrategy = RobotStrategy::Greedy)
+            : world{std::move(initialWorld)}, strategy{robotStrategy}, origin{world.field.rect.pos} {
+        if (!fits(world.field)) { throw std::logic_error{"The field is too large for bit planes."}; }
+        world.field.rect.forEach([&](Position pos) {
+            if (world.field.contains(pos)) { room.set(pos - origin); }
+        });
+        sweep.rowCount = (world.field.rect.size.height + 3) / 4 * 4;
+    }
+
+    /// Place new elements on the field, like `Logic::startGame`.
+    void startGame(Random gameRandom, int robotCount) {
+        const auto profileScope = ProfileScope{ProfilePoint::StartGame};
+        world.clearElements();
+        world.random = gameRandom.split();
+        random = gameRandom.split();
+        world.populate(robotCount);
+        robots.clear();
+        for (const auto &robot : world.robots) {
+            robots.set(robot.pos - origin);
+        }
+        exits.clear();
+        for (const auto &exit : world.exits) {
+            exits.set(exit.pos - origin);
+        }
+    }
+
+    /// The directions that bring the robot closest to the player, as the mask of `cPosDelta4` indices.
+    [[nodiscard]] auto bestMoveMask(Position robotPos) const noexcept -> unsigned {
+        const auto local = robotPos - origin;
+        auto free = room.neighbourMask(local) & ~robots.neighbourMask(local);
+        unsigned towards = 0;
+        if (strategy == RobotStrategy::FlowField && sweep.visited.test(local)) {
+            for (std::size_t i = 0; i < cPosDelta4.size(); ++i) {
+                towards |= static_cast<unsigned>(sweep.towardsOrigin[i].test(local)) << i;
+            }
+        } else {
+            const auto delta = world.player.pos - robotPos;
+            towards = static_cast<unsigned>(delta.x > 0) | static_cast<unsigned>(delta.y > 0) << 1
+                | static_cast<unsigned>(delta.x < 0) << 2 | static_cast<unsigned>(delta.y < 0) << 3;
+        }
+        // Neighbours are one step closer or one step further away, so if no free neighbour is
+        // closer, all free neighbours are equally good.
+        return (free & towards) != 0 ? free & towards : free;
+    }
+
+    void advanceRobot(std::size_t robotIndex) {
+        auto &robot = world.robots[robotIndex];
+        if (robot.pos == world.player.pos) { return; }
+        auto mask = bestMoveMask(robot.pos);
+        if (mask == 0) { return; }
+        for (auto choice = random.nextInt(0, std::popcount(mask) - 1); choice > 0; --choice) {
+            mask &= mask - 1;
+        }
+        const auto newPos = robot.pos + cPosDelta4[static_cast<std::size_t>(std::countr_zero(mask))];
+        robots.reset(robot.pos - origin);
+        robots.set(newPos - origin);
+        robot.moveTo(newPos);
+    }
+
+    /// @return `false` if the player could not move in the requested direction.
+    auto advance(PlayerInput input) -> bool {
+        const auto profileScope = ProfileScope{ProfilePoint::Turn};
+        const auto playerMoved = playerLogic.advance(input, world);
+        if (strategy == RobotStrategy::FlowField) { sweep.run(room, world.player.pos - origin, robots); }
+        for (std::size_t robotIndex = 0; robotIndex < world.robots.size(); ++robotIndex) {
+            advanceRobot(robotIndex);
+        }
+        return playerMoved;
+    }
+
+    [[nodiscard]] auto gameState() const noexcept -> GameState {
+        const auto local = world.player.pos - origin;
+        if (exits.test(local)) { return GameState::PlayerWon; }
+        if (robots.test(local)) { return GameState::RobotsWon; }
+        return GameState::Running;
+    }
+};
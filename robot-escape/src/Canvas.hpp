@@ -2,10 +2,8 @@
 
 #include "Geometry.hpp"
 
+#include <algorithm>
 #include <vector>
-#include <iostream>
-#include <numeric>
-#include <ranges>
 #include <cstdint>
 
 enum class Block : uint8_t {
@@ -17,20 +15,32 @@ enum class Block : uint8_t {
     PlayerTrail,
     Robot,
     RobotTrail,
+    HeatLow,    // the levels of a heatmap overlay, see `Heatmap::render`.
+    HeatMedium,
+    HeatHigh,
 };
 
 struct Canvas {
     Size size;
     std::vector<Block> data;
+    std::vector<uint8_t> wallMasks; // the wall shape for `Block::Wall` cells, see `Field::wallMasks`.
     Position topLeft;
 
     constexpr static auto cDefaultSize = Size{40, 20};
 
-    explicit Canvas(Size size = cDefaultSize) noexcept : size{size}, data(size.area(), Block::Empty) {}
+    explicit Canvas(Size size = cDefaultSize) noexcept
+        : size{size}, data(size.area(), Block::Empty), wallMasks(size.area(), 0) {}
     void setTopLeft(Position pos) noexcept { topLeft = pos; }
-    void setBlock(Block block, Position pos) noexcept {
+    /// The area of the field that is visible on this canvas.
+    [[nodiscard]] auto visibleRect() const noexcept -> Rectangle { return Rectangle{Position{} - topLeft, size}; }
+    void clear() noexcept {
+        std::ranges::fill(data, Block::Empty);
+        std::ranges::fill(wallMasks, 0);
+    }
+    void setBlock(Block block, Position pos, uint8_t wallMask = 0) noexcept {
         if (!size.contains(pos + topLeft)) { return; }
         data[size.index(pos + topLeft)] = block;
+        wallMasks[size.index(pos + topLeft)] = wallMask;
     }
     template<typename... PosArgs>
     void setBlocks(Block block, PosArgs... pos) noexcept {
@@ -46,46 +56,8 @@ struct Canvas {
         if (!size.contains(pos)) { return Block::Empty; }
         return data[size.index(pos)];
     }
-    void renderToConsole() const noexcept {
-        std::cout << "\x1b[0m";
-        auto lastBlock = Block::Player;
-        for (int y = 0; y < size.height; ++y) {
-            for (int x = 0; x < size.width; ++x) {
-                renderBlockAt({x, y}, lastBlock);
-            }
-            std::cout << '\n';
-        }
-        std::cout << "\x1b[0m\n";
-    }
-    void renderBlockAt(Position pos, Block &lastBlock) const noexcept {
-        static std::array<std::string_view, 16> walls = {
-            "■", "╺", "╻", "┏", "╸", "━", "┓", "┳", "╹", "┗", "┃", "┣", "┛", "┻", "┫", "╋"
-        };
-        auto block = blockFromOrigin(pos);
-        if (block != lastBlock) {
-            switch (block) {
-            case Block::Empty: std::cout << "\x1b[90m"; break;
-            case Block::Wall: std::cout << "\x1b[32m"; break;
-            case Block::Room: std::cout << "\x1b[0m"; break;;
-            case Block::Exit: std::cout << "\x1b[92m"; break;
-            case Block::Player: case Block::PlayerTrail: std::cout << "\x1b[93m"; break;
-            case Block::Robot: case Block::RobotTrail: std::cout << "\x1b[91m"; break;
-            }
-        }
-        switch (block) {
-        case Block::Empty: std::cout << "░"; break;
-        case Block::Wall: std::cout << walls[matchBlocks4(pos, Block::Wall)]; break;
-        case Block::Room: std::cout << " "; break;
-        case Block::Exit: std::cout << "⚑"; break;
-        case Block::Player: std::cout << "☻"; break;
-        case Block::Robot: std::cout << "♟"; break;
-        case Block::PlayerTrail: case Block::RobotTrail: std::cout << "∙"; break;
-        }
-        lastBlock = block;
+    [[nodiscard]] auto wallMaskFromOrigin(Position pos) const noexcept -> uint8_t {
+        if (!size.contains(pos)) { return 0; }
+        return wallMasks[size.index(pos)];
     }
-    [[nodiscard]] auto matchBlocks4(Position pos, Block block) const noexcept -> uint32_t {
-        return std::accumulate(cPosDelta4.rbegin(), cPosDelta4.rend(), 0U, [&](uint32_t acc, Position delta) {
-            return (acc << 1) | (blockFromOrigin(pos + delta) == block ? 1 : 0);
-        });
-    }
-};
\ No newline at end of file
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "Canvas.hpp"
+#include "Geometry.hpp"
+#include "Profiler.hpp"
+
+#include <unistd.h>
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+constexpr auto cBlockCount = static_cast<std::size_t>(Block::HeatHigh) + 1;
+constexpr std::size_t cWallMaskCount = 16;
+
+// The glyphs of the blocks, indexed by `Block`. The walls use the glyph for their wall mask instead.
+struct UnicodeGlyphs {
+    constexpr static std::array<std::string_view, cBlockCount> cGlyphs = {
+        "░", "", " ", "⚑", "☻", "∙", "♟", "∙", "▒", "▓", "█"
+    };
+    constexpr static std::array<std::string_view, cWallMaskCount> cWallGlyphs = {
+        "■", "╺", "╻", "┏", "╸", "━", "┓", "┳", "╹", "┗", "┃", "┣", "┛", "┻", "┫", "╋"
+    };
+};
+
+// The encodings of the console output. Each one has the color sequence of every block, indexed by
+// `Block`, the glyphs, and the sequence that resets the color at the end of a frame.
+struct AnsiEncoding : UnicodeGlyphs {
+    constexpr static std::array<std::string_view, cBlockCount> cColors = {
+        "\x1b[90m", "\x1b[32m", "\x1b[0m", "\x1b[92m", "\x1b[93m", "\x1b[93m", "\x1b[91m", "\x1b[91m",
+        "\x1b[34m", "\x1b[33m", "\x1b[31m"
+    };
+    constexpr static std::string_view cReset = "\x1b[0m";
+};
+
+struct Ansi256Encoding : UnicodeGlyphs {
+    constexpr static std::array<std::string_view, cBlockCount> cColors = {
+        "\x1b[38;5;240m", "\x1b[38;5;34m", "\x1b[0m", "\x1b[38;5;46m",
+        "\x1b[38;5;226m", "\x1b[38;5;226m", "\x1b[38;5;196m", "\x1b[38;5;196m",
+        "\x1b[38;5;27m", "\x1b[38;5;214m", "\x1b[38;5;160m"
+    };
+    constexpr static std::string_view cReset = "\x1b[0m";
+};
+
+struct TrueColorEncoding : UnicodeGlyphs {
+    constexpr static std::array<std::string_view, cBlockCount> cColors = {
+        "\x1b[38;2;100;100;100m", "\x1b[38;2;60;160;80m", "\x1b[0m", "\x1b[38;2;80;250;120m",
+        "\x1b[38;2;255;220;60m", "\x1b[38;2;255;220;60m", "\x1b[38;2;240;70;70m", "\x1b[38;2;240;70;70m",
+        "\x1b[38;2;60;110;220m", "\x1b[38;2;250;170;40m", "\x1b[38;2;210;40;40m"
+    };
+    constexpr static std::string_view cReset = "\x1b[0m";
+};
+
+// Plain ASCII without colors, for consoles without Unicode. The cursor is still positioned.
+struct AsciiEncoding {
+    constexpr static std::array<std::string_view, cBlockCount> cColors = {"", "", "", "", "", "", "", "", "", "", ""};
+    constexpr static std::array<std::string_view, cBlockCount> cGlyphs = {
+        ":", "", " ", "E", "@", ".", "R", ".", ".", "o", "O"
+    };
+    constexpr static std::array<std::string_view, cWallMaskCount> cWallGlyphs = {
+        "#", "-", "|", "+", "-", "-", "+", "+", "|", "+", "|", "+", "+", "+", "+", "+"
+    };
+    constexpr static std::string_view cReset = "";
+};
+
+enum class ConsoleEncoding : uint8_t {
+    Ansi,
+    Ansi256,
+    TrueColor,
+    Ascii,
+};
+
+// The bytes of one cell, composed at compile time: the color followed by the glyph, and the glyph
+// alone for a cell with the color of the previous cell. The arrays are always copied completely,
+// as a copy of a constant size is a few register moves.
+struct ConsoleCell {
+    std::array<char, 32> bytes{};
+    std::array<char, 8> glyph{};
+    uint8_t size{};
+    uint8_t glyphSize{};
+    uint8_t color{}; // equal for blocks with the same color sequence.
+
+    /// The cells of an encoding, indexed by `Block` and the wall mask, see `cellIndex`.
+    template<typename tEncoding>
+    [[nodiscard]] constexpr static auto makeTable() -> std::array<ConsoleCell, cBlockCount * cWallMaskCount> {
+        std::array<ConsoleCell, cBlockCount * cWallMaskCount> table{};
+        for (std::size_t block = 0; block < cBlockCount; ++block) {
+            const auto colorCode = tEncoding::cColors[block];
+            std::size_t color = 0;
+            while (tEncoding::cColors[color] != colorCode) { ++color; }
+            for (std::size_t wallMask = 0; wallMask < cWallMaskCount; ++wallMask) {
+                const auto glyph = block == static_cast<std::size_t>(Block::Wall)
+                    ? tEncoding::cWallGlyphs[wallMask] : tEncoding::cGlyphs[block];
+                if (colorCode.size() + glyph.size() > ConsoleCell{}.bytes.size() || glyph.size() > ConsoleCell{}.glyph.size()) {
+                    throw std::logic_error{"The sequence of a cell is too long."}; // fails the compilation.
+                }
+                auto &cell = table[cellIndex(static_cast<Block>(block), static_cast<uint8_t>(wallMask))];
+                std::ranges::copy(glyph, std::ranges::copy(colorCode, cell.bytes.begin()).out);
+                std::ranges::copy(glyph, cell.glyph.begin());
+                cell.size = static_cast<uint8_t>(colorCode.size() + glyph.size());
+                cell.glyphSize = static_cast<uint8_t>(glyph.size());
+                cell.color = static_cast<uint8_t>(color);
+            }
+        }
+        return table;
+    }
+
+    [[nodiscard]] constexpr static auto cellIndex(Block block, uint8_t wallMask) noexcept -> std::size_t {
+        return static_cast<std::size_t>(block) * cWallMaskCount + (wallMask & (cWallMaskCount - 1));
+    }
+};
+
+// Renders a canvas at a fixed place on the screen. It keeps the previous frame and only emits the
+// cells that changed, using cursor-positioning escape sequences, into one output buffer. Rows
+// without changes are skipped with one comparison each, and each cell is copied from the table
+// of the encoding.
+template<typename tEncoding>
+struct BasicConsoleRenderer {
+    constexpr static auto cCells = ConsoleCell::makeTable<tEncoding>();
+    constexpr static uint8_t cNoColor = 0xffU;
+    // Worst case per cell: cursor position, color and glyph.
+    constexpr static std::size_t cMaximumBytesPerCell = 32 + sizeof(ConsoleCell::bytes);
+    // The reset and the cursor position at the end.
+    constexpr static std::size_t cMaximumTrailerSize = 64;
+
+    int originRow{1}; // The screen row (starting at 1) of the first canvas row.
+    Size size;
+    std::vector<Block> previousBlocks;
+    std::vector<uint8_t> previousWallMasks;
+    bool fullRedraw{true};
+    std::string output; // the capacity for the worst case; only the start is the current frame.
+
+    /// Redraw everything with the next frame, e.g. after the screen was cleared.
+    void invalidate() noexcept { fullRedraw = true; }
+
+    [[nodiscard]] static auto appendNumber(char *out, int value) noexcept -> char* {
+        return std::to_chars(out, out + 16, value).ptr;
+    }
+
+    [[nodiscard]] static auto appendCursorMove(char *out, Position screenPos) noexcept -> char* {
+        *out++ = '\x1b';
+        *out++ = '[';
+        out = appendNumber(out, screenPos.y);
+        *out++ = ';';
+        out = appendNumber(out, screenPos.x);
+        *out++ = 'H';
+        return out;
+    }
+
+    [[nodiscard]] static auto append(char *out, std::string_view text) noexcept -> char* {
+        std::memcpy(out, text.data(), text.size());
+        return out + text.size();
+    }
+
+    /// @return The escape sequences and glyphs for this frame, valid until the next call.
+    [[nodiscard]] auto render(const Canvas &canvas) -> std::string_view {
+        const auto profileScope = ProfileScope{ProfilePoint::ConsoleRender};
+        if (canvas.size != size) {
+            size = canvas.size;
+            previousBlocks.assign(size.area(), Block::Empty);
+            previousWallMasks.assign(size.area(), 0);
+            output.resize(static_cast<std::size_t>(size.area()) * cMaximumBytesPerCell + cMaximumTrailerSize);
+            fullRedraw = true;
+        }
+        const auto width = static_cast<std::size_t>(size.width);
+        auto *out = output.data();
+        auto currentColor = cNoColor;
+        for (int y = 0; y < size.height; ++y) {
+            const auto rowIndex = static_cast<std::size_t>(size.index({0, y}));
+            const auto *blocks = canvas.data.data() + rowIndex;
+            const auto *wallMasks = canvas.wallMasks.data() + rowIndex;
+            if (!fullRedraw && std::memcmp(blocks, previousBlocks.data() + rowIndex, width) == 0
+                    && std::memcmp(wallMasks, previousWallMasks.data() + rowIndex, width) == 0) {
+                continue;
+            }
+            auto cursorX = -1;
+            for (int x = 0; x < size.width; ++x) {
+                const auto index = rowIndex + static_cast<std::size_t>(x);
+                const auto block = blocks[x];
+                const auto wallMask = wallMasks[x];
+                if (!fullRedraw && block == previousBlocks[index] && wallMask == previousWallMasks[index]) { continue; }
+                previousBlocks[index] = block;
+                previousWallMasks[index] = wallMask;
+                if (cursorX != x) { out = appendCursorMove(out, {x + 1, y + originRow}); }
+                const auto &cell = cCells[ConsoleCell::cellIndex(block, wallMask)];
+                if (cell.color != currentColor) {
+                    std::memcpy(out, cell.bytes.data(), cell.bytes.size());
+                    out += cell.size;
+                    currentColor = cell.color;
+                } else {
+                    std::memcpy(out, cell.glyph.data(), cell.glyph.size());
+                    out += cell.glyphSize;
+                }
+                cursorX = x + 1;
+            }
+        }
+        fullRedraw = false;
+        out = append(out, tEncoding::cReset);
+        out = appendCursorMove(out, {1, originRow + size.height + 1});
+        out = append(out, "\x1b[J");
+        return std::string_view{output.data(), static_cast<std::size_t>(out - output.data())};
+    }
+};
+
+// The renderer for the encoding that is chosen at runtime. The encoding is only dispatched once
+// per frame, the cells are rendered by the `BasicConsoleRenderer` of the encoding.
+struct ConsoleRenderer {
+    using Backend = std::variant<
+        BasicConsoleRenderer<AnsiEncoding>,
+        BasicConsoleRenderer<Ansi256Encoding>,
+        BasicConsoleRenderer<TrueColorEncoding>,
+        BasicConsoleRenderer<AsciiEncoding>>;
+
+    int originRow{1}; // The screen row (starting at 1) of the first canvas row.
+    Backend backend;
+
+    /// Switch to another encoding. The next frame is drawn completely.
+    void setEncoding(ConsoleEncoding encoding) {
+        if (static_cast<std::size_t>(encoding) == backend.index()) { return; }
+        switch (encoding) {
+        case ConsoleEncoding::Ansi: backend.emplace<BasicConsoleRenderer<AnsiEncoding>>(); break;
+        case ConsoleEncoding::Ansi256: backend.emplace<BasicConsoleRenderer<Ansi256Encoding>>(); break;
+        case ConsoleEncoding::TrueColor: backend.emplace<BasicConsoleRenderer<TrueColorEncoding>>(); break;
+        case ConsoleEncoding::Ascii: backend.emplace<BasicConsoleRenderer<AsciiEncoding>>(); break;
+        }
+    }
+
+    /// Redraw everything with the next frame, e.g. after the screen was cleared.
+    void invalidate() noexcept {
+        std::visit([](auto &renderer) { renderer.invalidate(); }, backend);
+    }
+
+    /// @return The escape sequences and glyphs for this frame, valid until the next call.
+    [[nodiscard]] auto render(const Canvas &canvas) -> std::string_view {
+        return std::visit([&](auto &renderer) {
+            renderer.originRow = originRow;
+            return renderer.render(canvas);
+        }, backend);
+    }
+
+    /// Write the bytes with a single system call, after anything that is still buffered in `std::cout`.
+    static void writeToConsole(std::string_view bytes) noexcept {
+        std::cout.flush();
+        while (!bytes.empty()) {
+            const auto written = ::write(STDOUT_FILENO, bytes.data(), bytes.size());
+            if (written <= 0) { return; }
+            bytes.remove_prefix(static_cast<std::size_t>(written));
+        }
+    }
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Field.hpp"
+#include "Geometry.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// Distances over the walkable cells inside `rect`. The sweep can be limited to a region of the
+// field, so its cost depends on the size of the region and not on the size of the field.
+struct DistanceField {
+    constexpr static int cUnreachable = std::numeric_limits<int>::max();
+    /// The margin around the elements of interest that is used for `regionAround`.
+    constexpr static int cRegionMargin = 16;
+    /// The buffers have at least this many cells, so the buffers for small fields are only allocated once.
+    constexpr static std::size_t cMinimumCapacity = 4096;
+
+    Rectangle rect;
+    std::vector<int> distances;
+    std::vector<int> queue;
+    std::size_t head{};
+    std::size_t tail{};
+
+    // Breadth-first sweep over the walkable cells of `field`, starting at `origin`.
+    // The buffers are reused between calls, so only the first update allocates.
+    void update(const Field &field, Position origin, Rectangle region) {
+        reset(field, region);
+        addOrigin(field, origin);
+        propagate(field);
+    }
+
+    /// The bounding box of `positions`, padded by `cRegionMargin`.
+    template<typename Range>
+    [[nodiscard]] static auto regionAround(Position first, const Range &positions) noexcept -> Rectangle {
+        auto region = Rectangle{first, Size{1, 1}};
+        for (const auto &pos : positions) {
+            region |= Rectangle{pos, Size{1, 1}};
+        }
+        return region.padded(cRegionMargin, cRegionMargin);
+    }
+
+    void reset(const Field &field, Rectangle region) {
+        rect = region.intersected(field.rect);
+        const auto area = static_cast<std::size_t>(rect.size.area());
+        // The regions differ from game to game. Growing the buffers at least twice, up to the area
+        // of the field, stops the reallocations after a few games.
+        if (area > distances.capacity()) {
+            const auto capacity = std::min(static_cast<std::size_t>(field.rect.size.area()),
+                std::max({area, 2 * distances.capacity(), cMinimumCapacity}));
+            distances.reserve(capacity);
+            queue.reserve(capacity);
+        }
+        distances.assign(area, cUnreachable);
+        queue.resize(area);
+        head = 0;
+        tail = 0;
+    }
+
+    void addOrigin(const Field &field, Position origin) noexcept {
+        if (!rect.contains(origin) || !field.contains(origin)) { return; }
+        const auto originIndex = rect.size.index(origin - rect.pos);
+        if (distances[originIndex] == 0) { return; }
+        distances[originIndex] = 0;
+        queue[tail++] = originIndex;
+    }
+
+    void propagate(const Field &field) noexcept {
+        const auto width = rect.size.width;
+        const auto height = rect.size.height;
+        while (head < tail) {
+            const auto index = queue[head++];
+            const auto x = index % width;
+            const auto y = index / width;
+            const auto pos = rect.pos + Position{x, y};
+            const auto nextDistance = distances[index] + 1;
+            auto visit = [&](int neighbour, Position neighbourPos) {
+                if (distances[neighbour] != cUnreachable || !field.contains(neighbourPos)) { return; }
+                distances[neighbour] = nextDistance;
+                queue[tail++] = neighbour;
+            };
+            if (x + 1 < width) { visit(index + 1, pos + Position{1, 0}); }
+            if (y + 1 < height) { visit(index + width, pos + Position{0, 1}); }
+            if (x > 0) { visit(index - 1, pos + Position{-1, 0}); }
+            if (y > 0) { visit(index - width, pos + Position{0, -1}); }
+        }
+    }
+
+    [[nodiscard]] auto distanceAt(Position pos) const noexcept -> int {
+        if (!rect.contains(pos)) { return cUnreachable; }
+        return distances[rect.size.index(pos - rect.pos)];
+    }
+
+    /// Sweep from `origin` over the cells that were not reached, and test if any of them has a
+    /// walkable neighbour outside of the region. Afterwards, these cells are not reached again.
+    /// @return `false` if everything that is connected to `origin` is inside the region.
+    [[nodiscard]] auto reachesOutside(const Field &field, Position origin) noexcept -> bool {
+        const auto first = tail;
+        addOrigin(field, origin);
+        propagate(field);
+        auto isOutside = false;
+        for (auto i = first; i < tail; ++i) {
+            const auto pos = rect.pos + Position{queue[i] % rect.size.width, queue[i] / rect.size.width};
+            isOutside = isOutside || std::ranges::any_of(cPosDelta4, [&](Position delta) {
+                return !rect.contains(pos + delta) && field.contains(pos + delta);
+            });
+            distances[queue[i]] = cUnreachable;
+        }
+        head = first;
+        tail = first;
+        return isOutside;
+    }
+};
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "Canvas.hpp"
+#include "Geometry.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <tuple>
+#include <vector>
+
+struct Room {
+    Rectangle rect;
+};
+
+// A square part of the field grid with the walkable cells and the cached wall shapes.
+struct FieldTile {
+    constexpr static int cSize = 32;
+    constexpr static uint8_t cNoWall = 0xff;
+
+    std::array<uint32_t, cSize> walkableRows{}; // bit `x` of row `y` is set if the cell is inside a room.
+    std::array<uint8_t, cSize * cSize> wallMasks{}; // the mask of the adjacent walls, or `cNoWall`.
+
+    [[nodiscard]] static auto filled(bool walkable) noexcept -> FieldTile {
+        FieldTile tile;
+        tile.walkableRows.fill(walkable ? 0xffffffffU : 0U);
+        tile.wallMasks.fill(cNoWall);
+        return tile;
+    }
+    [[nodiscard]] auto isWalkable(int x, int y) const noexcept -> bool {
+        return ((walkableRows[y] >> x) & 1U) != 0;
+    }
+    [[nodiscard]] auto wallMask(int x, int y) const noexcept -> uint8_t {
+        return wallMasks[y * cSize + x];
+    }
+    [[nodiscard]] auto isUniform() const noexcept -> bool {
+        const auto isFilled = walkableRows.front() == 0xffffffffU;
+        if (!isFilled && walkableRows.front() != 0) { return false; }
+        return std::ranges::all_of(walkableRows, [&](uint32_t row) { return row == walkableRows.front(); })
+            && std::ranges::all_of(wallMasks, [](uint8_t mask) { return mask == cNoWall; });
+    }
+};
+
+struct FieldGrid {
+    std::vector<uint32_t> tileIndices;
+    std::vector<FieldTile> tiles;
+};
+
+// The walkable area and the walls of a level. The grid is split into tiles, and only tiles that
+// contain a room outline are stored. All empty tiles share tile `cEmptyTile`, all tiles inside a
+// room share tile `cWalkableTile`. This way, memory use depends on the length of the outlines and
+// not on the area of the field, so huge fields are possible.
+struct Field {
+    constexpr static uint8_t cNoWall = FieldTile::cNoWall;
+    constexpr static uint32_t cEmptyTile = 0;
+    constexpr static uint32_t cWalkableTile = 1;
+    constexpr static auto cMinimumSize = Size{8, 8};
+    constexpr static auto cMaximumSize = Size{32000, 32000};
+
+    std::vector<Room> rooms;
+    Rectangle rect;
+    Rectangle gridRect; // `rect` padded by one cell, the area that contains all walls.
+    Size tileCount; // the number of tiles in each direction that cover `gridRect`.
+    std::span<const uint32_t> tileIndices; // for each tile, row by row, the index into `tiles`.
+    std::span<const FieldTile> tiles;
+    std::shared_ptr<const void> storage; // owns the memory of the grid, shared between copies of the field.
+
+    void updatePosAndSize() {
+        if (rooms.empty()) { rect = {}; return; }
+        rect = rooms.front().rect;
+        for (std::size_t i = 1; i < rooms.size(); ++i) {
+            rect |= rooms[i].rect;
+        }
+    }
+
+    [[nodiscard]] auto tileRect(Position tilePos) const noexcept -> Rectangle {
+        return Rectangle{gridRect.pos + Position{tilePos.x * FieldTile::cSize, tilePos.y * FieldTile::cSize},
+            Size{FieldTile::cSize, FieldTile::cSize}};
+    }
+
+    /// The range of tiles that overlap `area`, as a rectangle in tile coordinates.
+    [[nodiscard]] auto tilesOverlapping(Rectangle area) const noexcept -> Rectangle {
+        area = area.intersected(gridRect);
+        if (area.size.area() == 0) { return {}; }
+        const auto first = area.pos - gridRect.pos;
+        const auto last = area.bottomRight() - gridRect.pos - Position{1, 1};
+        return Rectangle{Position{first.x / FieldTile::cSize, first.y / FieldTile::cSize},
+            Size{Position{first.x / FieldTile::cSize, first.y / FieldTile::cSize},
+                Position{last.x / FieldTile::cSize + 1, last.y / FieldTile::cSize + 1}}};
+    }
+
+    // Computes the walkable cells and the wall shapes for one tile from the rooms that are near it.
+    // The wall shape only depends on the rooms, so it is computed once here instead of for every frame.
+    // Bit `i` of a wall mask is set if the neighbour at `cPosDelta4[i]` is a wall as well.
+    [[nodiscard]] static auto buildTile(Rectangle tileRect, std::span<const uint32_t> roomIndices,
+            const std::vector<Room> &rooms) noexcept -> FieldTile {
+        constexpr int cMargin = 2;
+        constexpr int cWindowSize = FieldTile::cSize + 2 * cMargin;
+        const auto window = tileRect.padded(cMargin, cMargin);
+        std::array<uint8_t, cWindowSize * cWindowSize> walkableWindow{};
+        for (const auto roomIndex : roomIndices) {
+            rooms[roomIndex].rect.intersected(window).forEach([&](Position pos) {
+                walkableWindow[window.size.index(pos - window.pos)] = 1;
+            });
+        }
+        auto isWalkable = [&](Position local) noexcept -> bool {
+            return walkableWindow[window.size.index(local)] != 0;
+        };
+        auto isWall = [&](Position local) noexcept -> bool {
+            return !isWalkable(local) && std::ranges::any_of(cPosDelta8, [&](Position delta) {
+                return isWalkable(local + delta);
+            });
+        };
+        FieldTile tile;
+        for (int y = 0; y < FieldTile::cSize; ++y) {
+            for (int x = 0; x < FieldTile::cSize; ++x) {
+                const auto local = Position{x + cMargin, y + cMargin};
+                auto mask = cNoWall;
+                if (isWalkable(local)) {
+                    tile.walkableRows[y] |= 1U << x;
+                } else if (isWall(local)) {
+                    mask = 0;
+                    for (std::size_t i = 0; i < cPosDelta4.size(); ++i) {
+                        if (isWall(local + cPosDelta4[i])) { mask |= static_cast<uint8_t>(1U << i); }
+                    }
+                }
+                tile.wallMasks[y * FieldTile::cSize + x] = mask;
+            }
+        }
+        return tile;
+    }
+
+    // Builds the tiled grid. Only tiles near a room are looked at, and tiles that are completely
+    // inside a room are not computed cell by cell. With `previous`, a grid of the same size, only the
+    // tiles near `changedRooms` are built, the others are copied from it.
+    // @return The number of tiles that were built.
+    auto buildGrid(const Field *previous, std::span<const Room> changedRooms) -> std::size_t {
+        gridRect = rect.padded(1, 1);
+        tileCount = Size{(gridRect.size.width + FieldTile::cSize - 1) / FieldTile::cSize,
+            (gridRect.size.height + FieldTile::cSize - 1) / FieldTile::cSize};
+        auto grid = std::make_shared<FieldGrid>();
+        grid->tiles = {FieldTile::filled(false), FieldTile::filled(true)};
+        grid->tileIndices.assign(tileCount.area(), cEmptyTile);
+        // Rooms reach two cells into their neighbour tiles: one cell of wall, and one more for the wall shape.
+        std::vector<uint32_t> roomOffsets(grid->tileIndices.size() + 1, 0);
+        auto forEachTileOfRoom = [&](Rectangle roomRect, auto fn) {
+            tilesOverlapping(roomRect.padded(2, 2)).forEach([&](Position tilePos) { fn(tileCount.index(tilePos)); });
+        };
+        for (const auto &room : rooms) {
+            forEachTileOfRoom(room.rect, [&](int tileIndex) { ++roomOffsets[tileIndex + 1]; });
+        }
+        for (std::size_t i = 1; i < roomOffsets.size(); ++i) {
+            roomOffsets[i] += roomOffsets[i - 1];
+        }
+        std::vector<uint32_t> roomIndices(roomOffsets.back());
+        auto fillPositions = std::vector<uint32_t>(roomOffsets.begin(), roomOffsets.end() - 1);
+        for (uint32_t roomIndex = 0; roomIndex < rooms.size(); ++roomIndex) {
+            forEachTileOfRoom(rooms[roomIndex].rect, [&](int tileIndex) { roomIndices[fillPositions[tileIndex]++] = roomIndex; });
+        }
+        std::vector<uint8_t> isChanged;
+        if (previous != nullptr) {
+            isChanged.assign(grid->tileIndices.size(), 0);
+            for (const auto &room : changedRooms) {
+                forEachTileOfRoom(room.rect, [&](int tileIndex) { isChanged[tileIndex] = 1; });
+            }
+        }
+        std::size_t builtTileCount = 0;
+        Rectangle{Position{}, tileCount}.forEach([&](Position tilePos) {
+            const auto tileIndex = tileCount.index(tilePos);
+            if (previous != nullptr && isChanged[tileIndex] == 0) {
+                const auto previousIndex = previous->tileIndices[tileIndex];
+                if (previousIndex == cEmptyTile || previousIndex == cWalkableTile) {
+                    grid->tileIndices[tileIndex] = previousIndex;
+                } else {
+                    grid->tileIndices[tileIndex] = static_cast<uint32_t>(grid->tiles.size());
+                    grid->tiles.push_back(previous->tiles[previousIndex]);
+                }
+                return;
+            }
+            const auto tileRooms = std::span{roomIndices}.subspan(
+                roomOffsets[tileIndex], roomOffsets[tileIndex + 1] - roomOffsets[tileIndex]);
+            if (tileRooms.empty()) { return; }
+            ++builtTileCount;
+            const auto currentTileRect = tileRect(tilePos);
+            if (std::ranges::any_of(tileRooms, [&](uint32_t roomIndex) { return rooms[roomIndex].rect.contains(currentTileRect); })) {
+                grid->tileIndices[tileIndex] = cWalkableTile;
+                return;
+            }
+            auto tile = buildTile(currentTileRect, tileRooms, rooms);
+            if (tile.isUniform()) {
+                grid->tileIndices[tileIndex] = tile.isWalkable(0, 0) ? cWalkableTile : cEmptyTile;
+                return;
+            }
+            grid->tileIndices[tileIndex] = static_cast<uint32_t>(grid->tiles.size());
+            grid->tiles.push_back(tile);
+        });
+        tileIndices = grid->tileIndices;
+        tiles = grid->tiles;
+        storage = std::move(grid);
+        return builtTileCount;
+    }
+    void update() {
+        updatePosAndSize();
+        buildGrid(nullptr, {});
+    }
+    /// The rooms that are only in one of the two lists, e.g. the rooms that were added to or removed from a level.
+    [[nodiscard]] static auto changedRooms(std::vector<Room> rooms, std::vector<Room> otherRooms) -> std::vector<Room> {
+        auto key = [](const Room &room) {
+            return std::tuple{room.rect.pos.x, room.rect.pos.y, room.rect.size.width, room.rect.size.height};
+        };
+        std::ranges::sort(rooms, {}, key);
+        std::ranges::sort(otherRooms, {}, key);
+        std::vector<Room> result;
+        std::ranges::set_symmetric_difference(rooms, otherRooms, std::back_inserter(result), {}, key, key);
+        return result;
+    }
+    /// Build the grid for changed rooms from the grid of `previous`, the same level before the
+    /// change: only the tiles near rooms that were added or removed are built again. If the size of
+    /// the level changed, the whole grid is built. @return The number of tiles that were built.
+    auto updateFrom(const Field &previous) -> std::size_t {
+        updatePosAndSize();
+        if (rect.padded(1, 1) != previous.gridRect) { return buildGrid(nullptr, {}); }
+        return buildGrid(&previous, changedRooms(rooms, previous.rooms));
+    }
+    void addRoom(Rectangle roomRect) {
+        rooms.emplace_back(Room{roomRect});
+        update();
+    }
+    /// Add many rooms at once, building the grid only once.
+    template<typename Range>
+    void addRooms(const Range &roomRects) {
+        for (const auto &roomRect : roomRects) {
+            rooms.emplace_back(Room{roomRect});
+        }
+        update();
+    }
+    /// The number of bytes used for the grid.
+    [[nodiscard]] auto gridMemorySize() const noexcept -> std::size_t {
+        return tileIndices.size_bytes() + tiles.size_bytes();
+    }
+    /// The number of walkable cells, counted per tile. Cells of a tile that is inside a room are all inside `rect`.
+    [[nodiscard]] auto walkableCellCount() const noexcept -> int64_t {
+        int64_t count = 0;
+        for (const auto tileIndex : tileIndices) {
+            for (const auto row : tiles[tileIndex].walkableRows) {
+                count += std::popcount(row);
+            }
+        }
+        return count;
+    }
+    [[nodiscard]] auto tileAt(Position gridPos) const noexcept -> const FieldTile& {
+        return tiles[tileIndices[tileCount.index({gridPos.x / FieldTile::cSize, gridPos.y / FieldTile::cSize})]];
+    }
+    [[nodiscard]] auto isNextToRoom(Position pos) const noexcept -> bool {
+        return std::ranges::any_of(cPosDelta8, [&](Position delta) -> bool { return contains(pos + delta); });
+    }
+    [[nodiscard]] auto isWall(Position pos) const noexcept -> bool {
+        return !contains(pos) && isNextToRoom(pos);
+    }
+    [[nodiscard]] auto wallMaskAt(Position pos) const noexcept -> uint8_t {
+        if (!gridRect.contains(pos)) { return cNoWall; }
+        const auto gridPos = pos - gridRect.pos;
+        return tileAt(gridPos).wallMask(gridPos.x % FieldTile::cSize, gridPos.y % FieldTile::cSize);
+    }
+    /// Render the part of the field that is visible on the canvas.
+    void render(Canvas &canvas) const noexcept {
+        gridRect.intersected(canvas.visibleRect()).forEach([&](Position pos) {
+            if (contains(pos)) {
+                canvas.setBlock(Block::Room, pos);
+            } else if (const auto wallMask = wallMaskAt(pos); wallMask != cNoWall) {
+                canvas.setBlock(Block::Wall, pos, wallMask);
+            }
+        });
+    }
+    [[nodiscard]] auto contains(Position pos) const noexcept -> bool {
+        if (!rect.contains(pos)) { return false; }
+        const auto gridPos = pos - gridRect.pos;
+        return tileAt(gridPos).isWalkable(gridPos.x % FieldTile::cSize, gridPos.y % FieldTile::cSize);
+    }
+    template<typename Fn> auto filterPositions(Fn fn) const -> std::vector<Position> {
+        std::vector<Position> result;
+        rect.forEach([&](const Position& pos) {
+            if (contains(pos) && fn(pos)) { result.push_back(pos); }
+        });
+        return result;
+    }
+};
@@ -0,0 +1,593 @@
+#pragma once
+
+#include "Canvas.hpp"
+#include "ConsoleRenderer.hpp"
+#include "LevelWatcher.hpp"
+#include "Logic.hpp"
+#include "Replay.hpp"
+#include "World.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// The protocol is a stream of single byte commands from the client, and lines from the server.
+// Commands: `e`, `s`, `w`, `n` move the player, `r` starts a new game, `v` switches between
+// state lines and rendered frames, `q` closes the connection. Other bytes are ignored.
+// The server sends the complete state when a game starts, and the changes after each move:
+//   G <game> <turn> <exit count> {<x> <y>} <player x> <player y> <robot count> {<x> <y>}
+//   T <turn> <player x> <player y> <moved robot count> {<robot index> <x> <y>} <R|W|L>
+// `R` means the game is running, `W` that the player won, and `L` that the robots won.
+// When a game ends, the server starts the next one right away. With frames, the server sends
+// a complete rendered frame for the console instead of each line.
+struct GameProtocol {
+    constexpr static auto cMoveCommands = std::array<char, 4>{'e', 's', 'w', 'n'}; // in the order of `cPosDelta4`.
+    constexpr static char cNewGameCommand = 'r';
+    constexpr static char cViewCommand = 'v';
+    constexpr static char cQuitCommand = 'q';
+
+    [[nodiscard]] static auto stateCode(GameState state) noexcept -> char {
+        switch (state) {
+        case GameState::Running: return 'R';
+        case GameState::PlayerWon: return 'W';
+        case GameState::RobotsWon: return 'L';
+        }
+        return 'R';
+    }
+};
+
+[[noreturn]] inline void throwSystemError(const std::string &what) {
+    throw std::system_error{errno, std::generic_category(), what};
+}
+
+// Where the server listens: a Unix socket, or a TCP port on the loopback interface.
+struct ServerAddress {
+    std::filesystem::path socketPath{"robot-escape.sock"};
+    int port{}; // if set, TCP is used instead of the Unix socket.
+
+    [[nodiscard]] auto text() const -> std::string {
+        return port != 0 ? std::format("127.0.0.1:{}", port) : socketPath.string();
+    }
+
+    [[nodiscard]] auto openSocket() const -> int {
+        const auto socketFd = ::socket(port != 0 ? AF_INET : AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (socketFd < 0) { throwSystemError("Could not create a socket"); }
+        return socketFd;
+    }
+
+    template<typename Fn>
+    void withAddress(Fn fn) const {
+        if (port != 0) {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(static_cast<uint16_t>(port));
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            fn(reinterpret_cast<const sockaddr*>(&address), static_cast<socklen_t>(sizeof(address)));
+            return;
+        }
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        const auto path = socketPath.string();
+        if (path.size() >= sizeof(address.sun_path)) { throw std::runtime_error{"The socket path is too long: " + path}; }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        fn(reinterpret_cast<const sockaddr*>(&address), static_cast<socklen_t>(sizeof(address)));
+    }
+
+    /// A non-blocking listening socket. A socket file left over from an earlier server is replaced.
+    [[nodiscard]] auto listen() const -> int {
+        const auto socketFd = openSocket();
+        if (port != 0) {
+            const int enable = 1;
+            ::setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        } else if (std::filesystem::is_socket(socketPath)) {
+            std::filesystem::remove(socketPath);
+        }
+        withAddress([&](const sockaddr *address, socklen_t length) {
+            if (::bind(socketFd, address, length) != 0 || ::listen(socketFd, SOMAXCONN) != 0) {
+                ::close(socketFd);
+                throwSystemError("Could not listen on " + text());
+            }
+        });
+        setNonBlocking(socketFd);
+        return socketFd;
+    }
+
+    /// A connected non-blocking socket.
+    [[nodiscard]] auto connect() const -> int {
+        const auto socketFd = openSocket();
+        withAddress([&](const sockaddr *address, socklen_t length) {
+            if (::connect(socketFd, address, length) != 0) {
+                ::close(socketFd);
+                throwSystemError("Could not connect to " + text());
+            }
+        });
+        setNonBlocking(socketFd);
+        setNoDelay(socketFd);
+        return socketFd;
+    }
+
+    static void setNonBlocking(int socketFd) {
+        if (::fcntl(socketFd, F_SETFL, ::fcntl(socketFd, F_GETFL) | O_NONBLOCK) != 0) { throwSystemError("Could not configure a socket"); }
+    }
+
+    void setNoDelay(int socketFd) const noexcept {
+        if (port == 0) { return; }
+        const int enable = 1;
+        ::setsockopt(socketFd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    }
+};
+
+// One client connection with its game. Slots are reused for new connections, so the containers of
+// the game keep their capacity and the memory per session stays the same.
+struct ServerSession {
+    int socket{-1};
+    uint32_t registeredEvents{}; // the epoll events this socket is registered for.
+    bool sendsFrames{false};
+    uint64_t gameIndex{};
+    int turn{};
+    Logic logic;
+    std::string output; // the bytes that were not sent yet, starting at `outputOffset`.
+    std::size_t outputOffset{};
+    std::string input; // the commands that were received while too much output was waiting.
+
+    [[nodiscard]] auto isOpen() const noexcept -> bool { return socket >= 0; }
+    [[nodiscard]] auto pendingOutput() const noexcept -> std::size_t { return output.size() - outputOffset; }
+
+    [[nodiscard]] auto memorySize() const noexcept -> std::size_t {
+        const auto &world = logic.world;
+        const auto &index = world.robotIndex;
+        return sizeof(ServerSession) + output.capacity() + input.capacity()
+            + world.field.rooms.capacity() * sizeof(Room)
+            + world.robots.capacity() * sizeof(Robot)
+            + world.exits.capacity() * sizeof(Exit)
+            + index.buckets.capacity() * sizeof(SpatialIndex::Bucket)
+            + index.positions.capacity() * sizeof(Position)
+            + index.nextElement.capacity() * sizeof(uint32_t);
+    }
+};
+
+struct ServerStatistics {
+    uint64_t connections{};
+    uint64_t games{}; // the games that ended with a win.
+    uint64_t playerWins{};
+    uint64_t moves{};
+    uint64_t bytesSent{};
+    std::size_t sessionSlots{};
+    std::size_t sessionMemory{}; // of all session slots.
+
+    void merge(const ServerStatistics &other) noexcept {
+        connections += other.connections;
+        games += other.games;
+        playerWins += other.playerWins;
+        moves += other.moves;
+        bytesSent += other.bytesSent;
+        sessionSlots += other.sessionSlots;
+        sessionMemory += other.sessionMemory;
+    }
+};
+
+struct GameServer;
+
+// A single-threaded epoll loop with its sessions. All loops wait on the same listening socket
+// (`EPOLLEXCLUSIVE` wakes only one of them), so connections spread over the loops.
+struct ServerLoop {
+    constexpr static uint64_t cListenerTag = ~uint64_t{0};
+    constexpr static uint64_t cStopTag = ~uint64_t{0} - 1;
+    constexpr static uint64_t cSignalTag = ~uint64_t{0} - 2;
+    constexpr static std::size_t cMaximumPendingOutput = 64 * 1024; // stop reading commands above this.
+    constexpr static int cMaximumEvents = 256;
+
+    GameServer &server;
+    int epoll{-1};
+    bool isAccepting{false};
+    std::vector<ServerSession> sessions;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> closedSlots; // free after the current batch of events, which may still name them.
+    ServerStatistics statistics;
+    // Shared by all sessions of the loop, as they are only needed during a turn.
+    std::array<char, 4096> readBuffer{};
+    std::vector<Position> previousRobotPositions;
+    DistanceField flowField;
+    std::shared_ptr<const Field> level; // the level for new games, see `refreshLevel`.
+    uint64_t levelVersion{};
+    Canvas canvas;
+    ConsoleRenderer renderer;
+
+    explicit ServerLoop(GameServer &server);
+    ServerLoop(const ServerLoop&) = delete;
+    auto operator=(const ServerLoop&) -> ServerLoop& = delete;
+    ~ServerLoop() {
+        for (auto &session : sessions) {
+            if (session.isOpen()) { ::close(session.socket); }
+        }
+        if (epoll >= 0) { ::close(epoll); }
+    }
+
+    void add(int fd, uint32_t events, uint64_t tag) const {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = tag;
+        if (::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) { throwSystemError("Could not watch a socket"); }
+    }
+
+    /// Wakes up every loop, and each one stops after its current batch of events.
+    static void stopAll(int stopEvent) noexcept {
+        // Nobody reads the event, so it wakes up every loop.
+        const uint64_t one = 1;
+        [[maybe_unused]] const auto written = ::write(stopEvent, &one, sizeof(one));
+    }
+
+    void refreshLevel();
+    void setAccepting(bool accepting);
+    void acceptConnections();
+    void startGame(ServerSession &session);
+    void sendState(ServerSession &session);
+    void sendFrame(ServerSession &session, std::string_view status);
+    void playMove(ServerSession &session, PlayerInput input);
+    void handleInput(uint32_t slot);
+    void executeCommands(uint32_t slot, std::string_view commands);
+    void flush(uint32_t slot);
+    void closeSession(uint32_t slot);
+    void run(int stopEvent, int signals);
+};
+
+// Hosts games for many clients, on one `ServerLoop` per thread. Game `n` of the server is started
+// like game `n` of a replay with the server seed. It runs until SIGINT or SIGTERM. The level can be
+// replaced while the server runs: the running games continue on their level, new games use the new one.
+struct GameServer {
+    Field field;
+    SharedLevel level; // starts with `field`, if nothing else was published before `run`.
+    int robotCount{3};
+    RobotStrategy robotStrategy{RobotStrategy::Greedy};
+    uint64_t seed{};
+    Size canvasSize{Canvas::cDefaultSize};
+    ServerAddress address;
+    unsigned threadCount{1};
+    int listener{-1};
+    std::atomic<uint64_t> nextGameIndex{0};
+
+    [[nodiscard]] auto run() -> ServerStatistics {
+        if (!level.current()) { level.publish(field); }
+        listener = address.listen();
+        const auto stopEvent = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        // The signals are blocked in all threads, and only read from `signals` by the first loop.
+        sigset_t signalSet;
+        sigemptyset(&signalSet);
+        sigaddset(&signalSet, SIGINT);
+        sigaddset(&signalSet, SIGTERM);
+        sigset_t previousSignalSet;
+        ::pthread_sigmask(SIG_BLOCK, &signalSet, &previousSignalSet);
+        const auto signals = ::signalfd(-1, &signalSet, SFD_NONBLOCK | SFD_CLOEXEC);
+        std::vector<std::unique_ptr<ServerLoop>> loops;
+        for (unsigned i = 0; i < std::max(threadCount, 1U); ++i) {
+            loops.push_back(std::make_unique<ServerLoop>(*this));
+        }
+        // If a loop fails, all loops are stopped, as the threads can only be joined after that,
+        // and the first error is thrown once all of them have ended.
+        std::vector<std::exception_ptr> errors(loops.size());
+        auto runLoop = [&](std::size_t i, int loopSignals) noexcept {
+            try {
+                loops[i]->run(stopEvent, loopSignals);
+            } catch (...) {
+                errors[i] = std::current_exception();
+                ServerLoop::stopAll(stopEvent);
+            }
+        };
+        {
+            std::vector<std::jthread> threads;
+            try {
+                for (std::size_t i = 1; i < loops.size(); ++i) {
+                    threads.emplace_back(runLoop, i, -1);
+                }
+            } catch (...) {
+                errors.front() = std::current_exception();
+                ServerLoop::stopAll(stopEvent);
+            }
+            if (!errors.front()) { runLoop(0, signals); }
+        }
+        ServerStatistics result;
+        for (const auto &loop : loops) {
+            result.merge(loop->statistics);
+        }
+        loops.clear();
+        ::close(signals);
+        ::close(stopEvent);
+        ::close(listener);
+        ::pthread_sigmask(SIG_SETMASK, &previousSignalSet, nullptr);
+        if (address.port == 0) { std::filesystem::remove(address.socketPath); }
+        for (const auto &error : errors) {
+            if (error) { std::rethrow_exception(error); }
+        }
+        return result;
+    }
+};
+
+inline ServerLoop::ServerLoop(GameServer &server) : server{server}, canvas{server.canvasSize} {
+    epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll < 0) { throwSystemError("Could not create an event loop"); }
+    renderer.originRow = 1;
+}
+
+// Checks for a new level once per batch of events, which is one atomic load if there is none.
+inline void ServerLoop::refreshLevel() {
+    const auto version = server.level.version.load(std::memory_order_acquire);
+    if (version == levelVersion) { return; }
+    level = server.level.current();
+    levelVersion = version;
+}
+
+// Without free file descriptors, the listener would wake the loop again and again, so it is
+// removed until a session is closed.
+inline void ServerLoop::setAccepting(bool accepting) {
+    if (accepting == isAccepting) { return; }
+    isAccepting = accepting;
+    if (accepting) {
+        add(server.listener, EPOLLIN | EPOLLEXCLUSIVE, cListenerTag);
+    } else {
+        ::epoll_ctl(epoll, EPOLL_CTL_DEL, server.listener, nullptr);
+    }
+}
+
+inline void ServerLoop::acceptConnections() {
+    while (true) {
+        const auto socketFd = ::accept4(server.listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (socketFd < 0) {
+            if (errno == EMFILE || errno == ENFILE) { setAccepting(false); }
+            return;
+        }
+        server.address.setNoDelay(socketFd);
+        uint32_t slot{};
+        if (freeSlots.empty()) {
+            slot = static_cast<uint32_t>(sessions.size());
+            sessions.push_back(ServerSession{.logic = Logic{World{*level}, server.robotStrategy}});
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        try {
+            add(socketFd, EPOLLIN, slot);
+        } catch (const std::system_error&) {
+            ::close(socketFd);
+            freeSlots.push_back(slot);
+            throw;
+        }
+        auto &session = sessions[slot];
+        session.socket = socketFd;
+        session.sendsFrames = false;
+        session.registeredEvents = EPOLLIN;
+        ++statistics.connections;
+        startGame(session);
+        flush(slot);
+    }
+}
+
+inline void ServerLoop::startGame(ServerSession &session) {
+    // A game never changes its level, so a new level is used from the next game of the session on.
+    if (session.logic.world.field.storage != level->storage) { session.logic.world.field = *level; }
+    session.gameIndex = server.nextGameIndex.fetch_add(1, std::memory_order_relaxed);
+    session.turn = 0;
+    ReplayFile::startGame(session.logic, server.seed, session.gameIndex, server.robotCount);
+    sendState(session);
+}
+
+inline void ServerLoop::sendState(ServerSession &session) {
+    if (session.sendsFrames) {
+        sendFrame(session, std::format("Game {}. Send n/e/s/w to move, r for a new game, v for state lines, q to quit.",
+            session.gameIndex));
+        return;
+    }
+    const auto &world = session.logic.world;
+    auto out = std::back_inserter(session.output);
+    std::format_to(out, "G {} {} {}", session.gameIndex, session.turn, world.exits.size());
+    for (const auto &exit : world.exits) {
+        std::format_to(out, " {} {}", exit.pos.x, exit.pos.y);
+    }
+    std::format_to(out, " {} {} {}", world.player.pos.x, world.player.pos.y, world.robots.size());
+    for (const auto &robot : world.robots) {
+        std::format_to(out, " {} {}", robot.pos.x, robot.pos.y);
+    }
+    session.output += '\n';
+}
+
+inline void ServerLoop::sendFrame(ServerSession &session, std::string_view status) {
+    canvas.clear();
+    session.logic.render(canvas);
+    renderer.invalidate();
+    session.output += "\x1b[H";
+    session.output += renderer.render(canvas);
+    session.output += status;
+    session.output += "\r\n";
+}
+
+inline void ServerLoop::playMove(ServerSession &session, PlayerInput input) {
+    auto &logic = session.logic;
+    previousRobotPositions.clear();
+    for (const auto &robot : logic.world.robots) {
+        previousRobotPositions.push_back(robot.pos);
+    }
+    std::swap(logic.robotLogic.distanceToPlayer, flowField);
+    logic.advance(input);
+    std::swap(logic.robotLogic.distanceToPlayer, flowField);
+    ++session.turn;
+    ++statistics.moves;
+    const auto state = logic.gameState();
+    if (session.sendsFrames) {
+        const auto status = state == GameState::Running ? std::string_view{"Your move."}
+            : state == GameState::PlayerWon ? std::string_view{"You won!"} : std::string_view{"You lost!"};
+        sendFrame(session, status);
+    } else {
+        const auto &robots = logic.world.robots;
+        std::size_t movedCount = 0;
+        for (std::size_t i = 0; i < robots.size(); ++i) {
+            if (robots[i].pos != previousRobotPositions[i]) { ++movedCount; }
+        }
+        auto out = std::back_inserter(session.output);
+        std::format_to(out, "T {} {} {} {}", session.turn, logic.world.player.pos.x, logic.world.player.pos.y, movedCount);
+        for (std::size_t i = 0; i < robots.size(); ++i) {
+            if (robots[i].pos != previousRobotPositions[i]) { std::format_to(out, " {} {} {}", i, robots[i].pos.x, robots[i].pos.y); }
+        }
+        std::format_to(out, " {}\n", GameProtocol::stateCode(state));
+    }
+    if (state != GameState::Running) {
+        ++statistics.games;
+        if (state == GameState::PlayerWon) { ++statistics.playerWins; }
+        startGame(session);
+    }
+}
+
+inline void ServerLoop::handleInput(uint32_t slot) {
+    const auto received = ::recv(sessions[slot].socket, readBuffer.data(), readBuffer.size(), 0);
+    if (received < 0 && (errno == EAGAIN || errno == EINTR)) { return; }
+    if (received <= 0) {
+        closeSession(slot);
+        return;
+    }
+    executeCommands(slot, std::string_view{readBuffer.data(), static_cast<std::size_t>(received)});
+}
+
+// Once too much output is waiting, e.g. after many moves with frames, the remaining commands are
+// kept in the session, and executed when the client has received enough of the output.
+inline void ServerLoop::executeCommands(uint32_t slot, std::string_view commands) {
+    auto &session = sessions[slot];
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+        if (session.pendingOutput() > cMaximumPendingOutput) {
+            flush(slot);
+            if (!session.isOpen()) { return; }
+            if (session.pendingOutput() > cMaximumPendingOutput) {
+                session.input.assign(commands.substr(i)); // `flush` already waits for the socket to be writable.
+                return;
+            }
+        }
+        const auto command = commands[i];
+        if (const auto move = std::ranges::find(GameProtocol::cMoveCommands, command); move != GameProtocol::cMoveCommands.end()) {
+            playMove(session, PlayerInput{cPosDelta4[static_cast<std::size_t>(move - GameProtocol::cMoveCommands.begin())]});
+        } else if (command == GameProtocol::cNewGameCommand) {
+            startGame(session);
+        } else if (command == GameProtocol::cViewCommand) {
+            session.sendsFrames = !session.sendsFrames;
+            sendState(session);
+        } else if (command == GameProtocol::cQuitCommand) {
+            closeSession(slot);
+            return;
+        }
+    }
+    flush(slot);
+}
+
+// Sends as much as the socket takes. The rest is sent when the socket is writable again, and
+// while too much is waiting, no more commands are read from this client.
+inline void ServerLoop::flush(uint32_t slot) {
+    auto &session = sessions[slot];
+    while (session.pendingOutput() > 0) {
+        const auto sent = ::send(session.socket, session.output.data() + session.outputOffset, session.pendingOutput(),
+            MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0 && errno == EINTR) { continue; }
+        if (sent < 0 && errno == EAGAIN) { break; }
+        if (sent < 0) {
+            closeSession(slot);
+            return;
+        }
+        session.outputOffset += static_cast<std::size_t>(sent);
+        statistics.bytesSent += static_cast<uint64_t>(sent);
+    }
+    if (session.pendingOutput() == 0) {
+        session.output.clear();
+        session.outputOffset = 0;
+        if (session.output.capacity() > cMaximumPendingOutput) { session.output.shrink_to_fit(); }
+    }
+    const auto events = (session.pendingOutput() <= cMaximumPendingOutput && session.input.empty() ? uint32_t{EPOLLIN} : 0U)
+        | (session.pendingOutput() > 0 ? uint32_t{EPOLLOUT} : 0U);
+    if (events != session.registeredEvents) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = slot;
+        ::epoll_ctl(epoll, EPOLL_CTL_MOD, session.socket, &event);
+        session.registeredEvents = events;
+    }
+}
+
+inline void ServerLoop::closeSession(uint32_t slot) {
+    auto &session = sessions[slot];
+    ::close(session.socket); // also removes it from the epoll set.
+    session.socket = -1;
+    session.output.clear();
+    session.outputOffset = 0;
+    session.input.clear();
+    closedSlots.push_back(slot);
+    setAccepting(true);
+}
+
+inline void ServerLoop::run(int stopEvent, int signals) {
+    refreshLevel();
+    setAccepting(true);
+    add(stopEvent, EPOLLIN, cStopTag);
+    if (signals >= 0) { add(signals, EPOLLIN, cSignalTag); }
+    std::array<epoll_event, cMaximumEvents> events{};
+    bool isStopping = false;
+    while (!isStopping) {
+        const auto eventCount = ::epoll_wait(epoll, events.data(), cMaximumEvents, -1);
+        if (eventCount < 0 && errno == EINTR) { continue; }
+        if (eventCount < 0) { throwSystemError("The event loop failed"); }
+        refreshLevel();
+        for (int i = 0; i < eventCount; ++i) {
+            const auto tag = events[i].data.u64;
+            if (tag == cListenerTag) {
+                acceptConnections();
+            } else if (tag == cStopTag) {
+                isStopping = true;
+            } else if (tag == cSignalTag) {
+                // The signal must be read, or it is delivered when the signals are unblocked again.
+                signalfd_siginfo signal{};
+                [[maybe_unused]] const auto read = ::read(signals, &signal, sizeof(signal));
+                stopAll(stopEvent);
+            } else {
+                const auto slot = static_cast<uint32_t>(tag);
+                if (!sessions[slot].isOpen()) { continue; } // closed by an earlier event of this batch.
+                if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0 && (events[i].events & EPOLLIN) == 0) {
+                    closeSession(slot);
+                    continue;
+                }
+                if ((events[i].events & EPOLLIN) != 0) { handleInput(slot); }
+                if ((events[i].events & EPOLLOUT) != 0 && sessions[slot].isOpen()) {
+                    flush(slot);
+                    auto &session = sessions[slot];
+                    if (session.isOpen() && !session.input.empty() && session.pendingOutput() <= cMaximumPendingOutput) {
+                        executeCommands(slot, std::exchange(session.input, {}));
+                    }
+                }
+            }
+        }
+        freeSlots.insert(freeSlots.end(), closedSlots.begin(), closedSlots.end());
+        closedSlots.clear();
+    }
+    statistics.sessionSlots = sessions.size();
+    for (const auto &session : sessions) {
+        statistics.sessionMemory += session.memorySize();
+    }
+}
@@ -1,14 +1,9 @@
 #pragma once
 
 #include <functional>
+#include <algorithm>
 #include <array>
-#include <random>
-#include <thread>
-
-inline auto randomInt(int minimum, int maximum) noexcept -> int {
-    thread_local std::mt19937 rng(std::random_device{}());
-    return std::uniform_int_distribution<int>{minimum, maximum}(rng);
-}
+#include <cstdlib>
 
 struct Position {
     int x{};
@@ -33,6 +28,8 @@ struct Position {
 
 constexpr static std::array<Position, 4> cPosDelta4 = {
     {{1, 0}, {0, 1}, {-1, 0}, {0, -1}}};
+constexpr static std::array<Position, 8> cPosDelta8 = {
+    {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}}};
 
 struct Size {
     int width{};
@@ -41,6 +38,8 @@ struct Size {
     Size() = default;
     constexpr Size(int width, int height) noexcept : width{width}, height{height} {}
     constexpr Size(Position pos1, Position pos2) noexcept : width{pos2.x - pos1.x}, height{pos2.y - pos1.y} {}
+    auto operator==(const Size &other) const noexcept -> bool = default;
+    auto operator!=(const Size &other) const noexcept -> bool = default;
     [[nodiscard]] auto fitsInto(Size other) const noexcept -> bool {
         return width <= other.width && height <= other.height;
     }
@@ -51,6 +50,9 @@ struct Size {
     [[nodiscard]] auto componentMax(Size other) const noexcept -> Size {
         return {std::max(width, other.width), std::max(height, other.height)};
     }
+    [[nodiscard]] auto componentMin(Size other) const noexcept -> Size {
+        return {std::min(width, other.width), std::min(height, other.height)};
+    }
     [[nodiscard]] auto contains(const Position& pos) const noexcept -> bool {
         return pos.x >= 0 && pos.y >= 0 && pos.x < width && pos.y < height;
     }
@@ -66,6 +68,8 @@ struct Rectangle {
     Rectangle() = default;
     constexpr Rectangle(int x, int y, int width, int height) noexcept : pos{x, y}, size{width, height} {}
     constexpr Rectangle(Position pos, Size size) noexcept : pos{pos}, size{size} {}
+    auto operator==(const Rectangle &other) const noexcept -> bool = default;
+    auto operator!=(const Rectangle &other) const noexcept -> bool = default;
     constexpr auto x2() const noexcept -> int { return pos.x + size.width; }
     constexpr auto y2() const noexcept -> int { return pos.y + size.height; }
     constexpr auto bottomRight() const noexcept -> Position { return {x2(), y2()}; }
@@ -82,10 +86,18 @@ struct Rectangle {
     [[nodiscard]] auto padded(int paddingX, int paddingY) const noexcept -> Rectangle {
         return Rectangle{pos.x - paddingX, pos.y - paddingY, size.width + paddingX * 2, size.height + paddingY * 2};
     }
+    [[nodiscard]] auto intersected(const Rectangle &other) const noexcept -> Rectangle {
+        auto newPos1 = pos.componentMax(other.pos);
+        auto newPos2 = bottomRight().componentMin(other.bottomRight()).componentMax(newPos1);
+        return Rectangle{newPos1, Size{newPos1, newPos2}};
+    }
     [[nodiscard]] auto contains(const Position& testedPosition) const noexcept -> bool {
         return testedPosition.x >= pos.x && testedPosition.y >= pos.y
             && testedPosition.x < x2() && testedPosition.y < y2();
     }
+    [[nodiscard]] auto contains(const Rectangle& other) const noexcept -> bool {
+        return other.pos.x >= pos.x && other.pos.y >= pos.y && other.x2() <= x2() && other.y2() <= y2();
+    }
     template<typename Fn> void forEach(Fn fn) const {
         for (int y = 0; y < size.height; ++y) {
             for (int x = 0; x < size.width; ++x) {
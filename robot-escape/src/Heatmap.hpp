@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Canvas.hpp"
+#include "Field.hpp"
+#include "Logic.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class HeatmapLayer : uint8_t {
+    PlayerVisits, ///< The turns the player spent on the cell.
+    RobotVisits,  ///< The turns any robot spent on the cell.
+    Captures,     ///< The games in which the player was caught on the cell.
+};
+
+constexpr std::size_t cHeatmapLayerCount = 3;
+constexpr std::array<std::string_view, cHeatmapLayerCount> cHeatmapLayerNames = {"player", "robots", "captures"};
+
+// Counters per cell of a field, collected over many games. The player and the robots only stand on
+// walkable cells, so the counters are only kept for the tiles of the field that are not empty, and
+// the memory follows the rooms, not the area of the field. Each layer is one flat array, tile by
+// tile, so a turn costs one increment for the player and one for each robot. A simulation counts
+// into a `HeatmapShard` with 32-bit counters per thread, and adds it to the 64-bit totals of a
+// `Heatmap` before any counter could wrap, and at the end.
+template<typename tCount>
+struct BasicHeatmap {
+    constexpr static int cTileSize = FieldTile::cSize;
+    constexpr static std::size_t cTileArea = cTileSize * cTileSize;
+    constexpr static uint32_t cNoTile = std::numeric_limits<uint32_t>::max();
+    // The robots never share a cell, so each turn adds at most one to a counter.
+    constexpr static uint64_t cMaximumTurns = std::numeric_limits<tCount>::max();
+    constexpr static std::size_t cMaximumMemorySize = std::size_t{2} << 30U; // for the heatmaps of all threads.
+    constexpr static int cPgmMaximum = 255;
+
+    Rectangle rect; // the `gridRect` of the field.
+    Size tileCount; // the `tileCount` of the field.
+    std::vector<uint32_t> tileOffsets; // for each tile of the field, the offset of its cells in the layers, or `cNoTile`.
+    std::array<std::vector<tCount>, cHeatmapLayerCount> layers;
+    uint64_t countedTurns{}; // since the counters were cleared.
+
+    BasicHeatmap() = default;
+    explicit BasicHeatmap(const Field &field)
+            : rect{field.gridRect}, tileCount{field.tileCount}, tileOffsets(field.tileIndices.size(), cNoTile) {
+        std::size_t cellCount = 0;
+        for (std::size_t i = 0; i < field.tileIndices.size(); ++i) {
+            if (field.tileIndices[i] == Field::cEmptyTile) { continue; }
+            tileOffsets[i] = static_cast<uint32_t>(cellCount);
+            cellCount += cTileArea;
+        }
+        for (auto &layer : layers) {
+            layer.assign(cellCount, 0);
+        }
+    }
+
+    /// The number of bytes of one heatmap for `field`.
+    [[nodiscard]] static auto memorySize(const Field &field) noexcept -> std::size_t {
+        const auto usedTileCount = static_cast<std::size_t>(std::ranges::count_if(field.tileIndices,
+            [](uint32_t tileIndex) { return tileIndex != Field::cEmptyTile; }));
+        return usedTileCount * cTileArea * cHeatmapLayerCount * sizeof(tCount) + field.tileIndices.size() * sizeof(uint32_t);
+    }
+
+    [[nodiscard]] auto empty() const noexcept -> bool { return tileOffsets.empty(); }
+    [[nodiscard]] auto countAt(HeatmapLayer layer, Position pos) const noexcept -> uint64_t {
+        if (!rect.contains(pos)) { return 0; }
+        const auto gridPos = pos - rect.pos;
+        if (tileOffsets[tileIndexOf(gridPos)] == cNoTile) { return 0; }
+        return layers[static_cast<std::size_t>(layer)][cellIndexOf(gridPos)];
+    }
+    [[nodiscard]] auto maximum(HeatmapLayer layer) const noexcept -> uint64_t {
+        const auto &values = layers[static_cast<std::size_t>(layer)];
+        return values.empty() ? 0 : std::ranges::max(values);
+    }
+    [[nodiscard]] auto tileIndexOf(Position gridPos) const noexcept -> std::size_t {
+        return static_cast<std::size_t>(tileCount.index({gridPos.x / cTileSize, gridPos.y / cTileSize}));
+    }
+    /// The index of a cell in the layers. The cell must be in a tile that is not empty.
+    [[nodiscard]] auto cellIndexOf(Position gridPos) const noexcept -> std::size_t {
+        return tileOffsets[tileIndexOf(gridPos)]
+            + static_cast<std::size_t>(gridPos.y % cTileSize * cTileSize + gridPos.x % cTileSize);
+    }
+
+    /// Test if `turns` more turns can be counted, without the risk that a counter wraps.
+    [[nodiscard]] auto canCount(uint64_t turns) const noexcept -> bool {
+        return turns <= cMaximumTurns - countedTurns;
+    }
+
+    /// Count the positions of the player and the robots, at the start of a game and after each turn.
+    void addTurn(const World &world) noexcept {
+        ++countedTurns;
+        ++layers[static_cast<std::size_t>(HeatmapLayer::PlayerVisits)][cellIndexOf(world.player.pos - rect.pos)];
+        auto *robotVisits = layers[static_cast<std::size_t>(HeatmapLayer::RobotVisits)].data();
+        for (const auto &robot : world.robots) {
+            ++robotVisits[cellIndexOf(robot.pos - rect.pos)];
+        }
+    }
+    void addGameEnd(const World &world, GameState state) noexcept {
+        if (state != GameState::RobotsWon) { return; }
+        ++layers[static_cast<std::size_t>(HeatmapLayer::Captures)][cellIndexOf(world.player.pos - rect.pos)];
+    }
+    /// Add the counts of a heatmap of the same field, with counters that are not wider.
+    template<typename tOtherCount>
+    void add(const BasicHeatmap<tOtherCount> &other) noexcept {
+        static_assert(sizeof(tOtherCount) <= sizeof(tCount));
+        for (std::size_t i = 0; i < cHeatmapLayerCount; ++i) {
+            std::ranges::transform(layers[i], other.layers[i], layers[i].begin(), [](tCount count, tOtherCount otherCount) {
+                return count + otherCount;
+            });
+        }
+        countedTurns += other.countedTurns;
+    }
+    void clear() noexcept {
+        for (auto &layer : layers) {
+            std::ranges::fill(layer, 0);
+        }
+        countedTurns = 0;
+    }
+
+    /// Write all layers as CSV, one line per walkable cell.
+    void writeCsv(const Field &field, const std::filesystem::path &path) const {
+        std::ofstream file{path, std::ios::trunc};
+        std::string line = "x,y";
+        for (const auto name : cHeatmapLayerNames) {
+            std::format_to(std::back_inserter(line), ",{}", name);
+        }
+        file << line << "\n";
+        rect.forEach([&](Position pos) {
+            if (!field.contains(pos)) { return; } // the other cells are never visited.
+            line.clear();
+            std::format_to(std::back_inserter(line), "{},{}", pos.x, pos.y);
+            for (std::size_t i = 0; i < cHeatmapLayerCount; ++i) {
+                std::format_to(std::back_inserter(line), ",{}", countAt(static_cast<HeatmapLayer>(i), pos));
+            }
+            file << line << "\n";
+        });
+        if (!file) { throw std::runtime_error{"Could not write heatmap " + path.string()}; }
+    }
+
+    /// Write one layer as binary PGM image, one pixel per cell, scaled to the highest count.
+    void writePgm(HeatmapLayer layer, const std::filesystem::path &path) const {
+        const auto highest = std::max<uint64_t>(maximum(layer), 1);
+        std::vector<char> pixels(static_cast<std::size_t>(rect.size.area()));
+        rect.forEach([&](Position pos) {
+            pixels[static_cast<std::size_t>(rect.size.index(pos - rect.pos))]
+                = static_cast<char>(countAt(layer, pos) * cPgmMaximum / highest);
+        });
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file << std::format("P5\n{} {}\n{}\n", rect.size.width, rect.size.height, cPgmMaximum);
+        file.write(pixels.data(), static_cast<std::streamsize>(pixels.size()));
+        if (!file) { throw std::runtime_error{"Could not write heatmap " + path.string()}; }
+    }
+
+    /// Draw one layer over the visible cells of the canvas, in three levels relative to the highest count.
+    void render(Canvas &canvas, HeatmapLayer layer) const noexcept {
+        const auto highest = maximum(layer);
+        if (highest == 0) { return; }
+        rect.intersected(canvas.visibleRect()).forEach([&](Position pos) {
+            const auto value = countAt(layer, pos);
+            if (value == 0) { return; }
+            if (value * 3 > highest * 2) {
+                canvas.setBlock(Block::HeatHigh, pos);
+            } else if (value * 3 > highest) {
+                canvas.setBlock(Block::HeatMedium, pos);
+            } else {
+                canvas.setBlock(Block::HeatLow, pos);
+            }
+        });
+    }
+};
+
+using Heatmap = BasicHeatmap<uint64_t>;
+using HeatmapShard = BasicHeatmap<uint32_t>;
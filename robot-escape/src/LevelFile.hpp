@@ -0,0 +1,163 @@
+#pragma once
+
+#include "Field.hpp"
+#include "Geometry.hpp"
+#include "MappedFile.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+// A compiled level: the header, followed by the rooms and the precomputed tiled grid of `Field`.
+// All values are stored in native byte order; `byteOrderMark` detects files from other platforms.
+// The grid is used in place from the mapped file, so loading a level does not parse anything.
+struct LevelFileHeader {
+    constexpr static std::array<char, 8> cMagic = {'R', 'O', 'B', 'O', 'L', 'V', 'L', '\0'};
+    constexpr static uint32_t cVersion = 2;
+    constexpr static uint32_t cByteOrderMark = 0x01020304U;
+
+    std::array<char, 8> magic{cMagic};
+    uint32_t version{cVersion};
+    uint32_t byteOrderMark{cByteOrderMark};
+    std::array<int32_t, 4> rect{}; // x, y, width, height
+    uint64_t roomCount{};
+    uint64_t roomsOffset{}; // `roomCount` rectangles as four `int32_t`: x, y, width, height
+    std::array<int32_t, 2> tileCount{}; // `Field::tileCount`: width, height
+    uint32_t tileSize{FieldTile::cSize};
+    uint32_t reserved{};
+    uint64_t tileIndicesOffset{}; // `Field::tileIndices`, one `uint32_t` per tile
+    uint64_t tileDataCount{};
+    uint64_t tileDataOffset{}; // `Field::tiles`, `tileDataCount` times `FieldTile`
+    uint64_t fileSize{};
+};
+
+struct LevelFile {
+    constexpr static std::size_t cAlignment = 8;
+
+    [[nodiscard]] static auto aligned(uint64_t offset) noexcept -> uint64_t {
+        return (offset + cAlignment - 1) / cAlignment * cAlignment;
+    }
+
+    [[nodiscard]] static auto hasSignature(const std::filesystem::path &path) -> bool {
+        std::ifstream file{path, std::ios::binary};
+        auto magic = std::array<char, 8>{};
+        file.read(magic.data(), magic.size());
+        return file && magic == LevelFileHeader::cMagic;
+    }
+
+    static void write(const Field &field, const std::filesystem::path &path) {
+        LevelFileHeader header;
+        header.rect = {field.rect.pos.x, field.rect.pos.y, field.rect.size.width, field.rect.size.height};
+        header.roomCount = field.rooms.size();
+        header.roomsOffset = aligned(sizeof(LevelFileHeader));
+        header.tileCount = {field.tileCount.width, field.tileCount.height};
+        header.tileIndicesOffset = aligned(header.roomsOffset + header.roomCount * sizeof(std::array<int32_t, 4>));
+        header.tileDataCount = field.tiles.size();
+        header.tileDataOffset = aligned(header.tileIndicesOffset + field.tileIndices.size_bytes());
+        header.fileSize = header.tileDataOffset + field.tiles.size_bytes();
+        auto data = std::string(header.fileSize, '\0');
+        std::memcpy(data.data(), &header, sizeof(header));
+        for (std::size_t i = 0; i < field.rooms.size(); ++i) {
+            const auto &roomRect = field.rooms[i].rect;
+            const auto values = std::array<int32_t, 4>{roomRect.pos.x, roomRect.pos.y, roomRect.size.width, roomRect.size.height};
+            std::memcpy(data.data() + header.roomsOffset + i * sizeof(values), values.data(), sizeof(values));
+        }
+        std::memcpy(data.data() + header.tileIndicesOffset, field.tileIndices.data(), field.tileIndices.size_bytes());
+        std::memcpy(data.data() + header.tileDataOffset, field.tiles.data(), field.tiles.size_bytes());
+        // A process may have the current file mapped, e.g. a server with `--watch`. Truncating it would
+        // take the pages away from its running games, so the new file is written under a temporary
+        // name and renamed over the old one, which stays intact until it is unmapped.
+        auto temporaryPath = path;
+        temporaryPath += std::format(".{}.tmp", ::getpid());
+        std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        file.close();
+        std::error_code error;
+        if (file) { std::filesystem::rename(temporaryPath, path, error); }
+        if (!file || error) {
+            std::filesystem::remove(temporaryPath, error);
+            throw std::runtime_error{"Could not write level file " + path.string()};
+        }
+    }
+
+    /// Test if the rectangle `inner` is not empty and inside `outer`, both as x, y, width and height.
+    [[nodiscard]] static auto isInside(const std::array<int32_t, 4> &inner, const std::array<int32_t, 4> &outer) noexcept -> bool {
+        return inner[2] > 0 && inner[3] > 0 && inner[0] >= outer[0] && inner[1] >= outer[1]
+            && int64_t{inner[0]} + inner[2] <= int64_t{outer[0]} + outer[2]
+            && int64_t{inner[1]} + inner[3] <= int64_t{outer[1]} + outer[3];
+    }
+
+    // Only the header, the rooms and the tile indices are checked, the tiles were validated when the level was compiled.
+    [[nodiscard]] static auto read(const std::filesystem::path &path) -> Field {
+        auto mappedFile = std::make_shared<const MappedFile>(path);
+        const auto bytes = mappedFile->bytes();
+        auto fail = [&](const char *reason) {
+            throw std::runtime_error{std::string{"Invalid level file "} + path.string() + ": " + reason};
+        };
+        LevelFileHeader header;
+        if (bytes.size() < sizeof(header)) { fail("The file is too small."); }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (header.magic != LevelFileHeader::cMagic) { fail("Unknown file format."); }
+        if (header.byteOrderMark != LevelFileHeader::cByteOrderMark) { fail("The file was written with a different byte order."); }
+        if (header.version != LevelFileHeader::cVersion || header.tileSize != FieldTile::cSize) { fail("Unsupported version."); }
+        // The sizes are checked before anything is computed with them, and in 64 bits: the grid around
+        // the field must be within the range of `int`, and the tile count must be the one of the grid.
+        const auto [x, y, width, height] = header.rect;
+        if (width <= 0 || height <= 0 || !Size{width, height}.fitsInto(Field::cMaximumSize)
+            || int64_t{x} - 1 < std::numeric_limits<int>::min() || int64_t{x} + width + 1 > std::numeric_limits<int>::max()
+            || int64_t{y} - 1 < std::numeric_limits<int>::min() || int64_t{y} + height + 1 > std::numeric_limits<int>::max()) {
+            fail("Invalid field size.");
+        }
+        Field field;
+        field.rect = Rectangle{x, y, width, height};
+        field.gridRect = field.rect.padded(1, 1);
+        field.tileCount = Size{(field.gridRect.size.width + FieldTile::cSize - 1) / FieldTile::cSize,
+            (field.gridRect.size.height + FieldTile::cSize - 1) / FieldTile::cSize};
+        if (header.tileCount[0] != field.tileCount.width || header.tileCount[1] != field.tileCount.height) {
+            fail("The tile count does not match the field size.");
+        }
+        const auto tileIndexCount = static_cast<uint64_t>(field.tileCount.width) * static_cast<uint64_t>(field.tileCount.height);
+        // Each part is checked on its own before anything is added, so the values of a crafted header
+        // can not wrap around: the offset is within the file, and the part fits into the rest of it.
+        auto fitsIntoFile = [&](uint64_t offset, uint64_t count, uint64_t elementSize) -> bool {
+            return offset >= sizeof(header) && offset <= bytes.size() && count <= (bytes.size() - offset) / elementSize;
+        };
+        if (header.fileSize != bytes.size()
+            || !fitsIntoFile(header.roomsOffset, header.roomCount, sizeof(std::array<int32_t, 4>))
+            || !fitsIntoFile(header.tileIndicesOffset, tileIndexCount, sizeof(uint32_t))
+            || !fitsIntoFile(header.tileDataOffset, header.tileDataCount, sizeof(FieldTile))
+            || header.roomsOffset + header.roomCount * sizeof(std::array<int32_t, 4>) > header.tileIndicesOffset
+            || header.tileIndicesOffset + tileIndexCount * sizeof(uint32_t) > header.tileDataOffset
+            || header.tileIndicesOffset % alignof(uint32_t) != 0
+            || header.tileDataOffset % alignof(FieldTile) != 0) {
+            fail("The file is truncated or corrupt.");
+        }
+        field.rooms.resize(header.roomCount);
+        for (std::size_t i = 0; i < field.rooms.size(); ++i) {
+            auto values = std::array<int32_t, 4>{};
+            std::memcpy(values.data(), bytes.data() + header.roomsOffset + i * sizeof(values), sizeof(values));
+            if (!isInside(values, header.rect)) { fail("A room is outside of the field."); }
+            field.rooms[i].rect = Rectangle{values[0], values[1], values[2], values[3]};
+        }
+        field.tileIndices = std::span{
+            reinterpret_cast<const uint32_t*>(bytes.data() + header.tileIndicesOffset), tileIndexCount};
+        field.tiles = std::span{
+            reinterpret_cast<const FieldTile*>(bytes.data() + header.tileDataOffset), header.tileDataCount};
+        if (field.tiles.size() < 2 || std::ranges::any_of(field.tileIndices, [&](uint32_t index) { return index >= field.tiles.size(); })) {
+            fail("The file contains invalid tile indices.");
+        }
+        field.storage = std::move(mappedFile);
+        return field;
+    }
+};
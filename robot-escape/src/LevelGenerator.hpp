@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Field.hpp"
+#include "Logic.hpp"
+#include "Random.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct LevelGeneratorSettings {
+    Size bounds{48, 24}; // all rooms are placed inside this area.
+    int minimumRoomCount{4};
+    int maximumRoomCount{10};
+    int minimumRoomSize{3}; // the length of each side of a room.
+    int maximumRoomSize{10};
+    int robotCount{3};
+    RobotStrategy robotStrategy{RobotStrategy::Greedy};
+};
+
+enum class LevelCheck : uint8_t {
+    Valid,
+    TooSmall,
+    TooLarge,
+    TooCrowded, // the elements may not fit.
+};
+
+// Generates random levels. Every room after the first one is joined to a random earlier room by an
+// L-shaped corridor between their centers, so every layout is connected. A layout that does not pass
+// `check` is replaced by the next one from the same generator, so level `n` of a seed is always the same.
+struct LevelGenerator {
+    constexpr static int cMaximumAttempts = 64;
+    constexpr static int cMaximumRoomCount = 100000;
+
+    LevelGeneratorSettings settings;
+
+    /// Check a field with the rules of `Application::validateField` and `World::populate`, without
+    /// placing any element, so this is fast and never throws.
+    [[nodiscard]] static auto check(const Field &field, int robotCount) noexcept -> LevelCheck {
+        if (!Field::cMinimumSize.fitsInto(field.rect.size)) { return LevelCheck::TooSmall; }
+        if (!field.rect.size.fitsInto(Field::cMaximumSize)) { return LevelCheck::TooLarge; }
+        if (!World::canAlwaysPopulate(field.walkableCellCount(), robotCount)) { return LevelCheck::TooCrowded; }
+        return LevelCheck::Valid;
+    }
+
+    [[nodiscard]] auto roomRects(Random &random) const -> std::vector<Rectangle> {
+        const auto roomCount = random.nextInt(settings.minimumRoomCount, settings.maximumRoomCount);
+        std::vector<Rectangle> rooms;
+        std::vector<Rectangle> result;
+        for (int i = 0; i < roomCount; ++i) {
+            const auto width = random.nextInt(settings.minimumRoomSize, std::min(settings.maximumRoomSize, settings.bounds.width));
+            const auto height = random.nextInt(settings.minimumRoomSize, std::min(settings.maximumRoomSize, settings.bounds.height));
+            const auto room = Rectangle{random.nextInt(0, settings.bounds.width - width),
+                random.nextInt(0, settings.bounds.height - height), width, height};
+            if (!rooms.empty()) {
+                const auto from = room.center();
+                const auto to = rooms[static_cast<std::size_t>(random.nextInt(0, i - 1))].center();
+                result.emplace_back(std::min(from.x, to.x), from.y, std::abs(from.x - to.x) + 1, 1);
+                result.emplace_back(to.x, std::min(from.y, to.y), 1, std::abs(from.y - to.y) + 1);
+            }
+            rooms.push_back(room);
+            result.push_back(room);
+        }
+        return result;
+    }
+
+    /// Generate the next valid level from `random`, or nothing if `cMaximumAttempts` layouts in a row
+    /// were rejected, which means that the settings leave too little room for the robots.
+    [[nodiscard]] auto generate(Random &random, uint64_t &rejectedCount) const -> std::optional<Field> {
+        for (int attempt = 0; attempt < cMaximumAttempts; ++attempt) {
+            Field field;
+            field.addRooms(roomRects(random));
+            if (check(field, settings.robotCount) == LevelCheck::Valid) { return field; }
+            ++rejectedCount;
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] static auto strategyName(RobotStrategy strategy) noexcept -> const char* {
+        return strategy == RobotStrategy::FlowField ? "flow_field" : "greedy";
+    }
+
+    /// The level as configuration, in the format that `Application::buildField` reads.
+    [[nodiscard]] auto configurationText(const Field &field) const -> std::string {
+        std::string text;
+        for (const auto &room : field.rooms) {
+            text += std::format("*[field.room]\nrectangle: {}, {}, {}, {}\n",
+                room.rect.pos.x, room.rect.pos.y, room.rect.size.width, room.rect.size.height);
+        }
+        text += std::format("\n[robots]\nstrategy: \"{}\"\ncount: {}\n", strategyName(settings.robotStrategy), settings.robotCount);
+        return text;
+    }
+
+    void writeConfiguration(const Field &field, const std::filesystem::path &path) const {
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        file << configurationText(field);
+        if (!file) { throw std::runtime_error{"Could not write configuration file " + path.string()}; }
+    }
+};
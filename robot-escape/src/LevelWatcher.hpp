@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Field.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+
+// The level of a long-running process. It is replaced as a whole, so a reader always gets a
+// complete level. The games that are running keep the level they started with.
+struct SharedLevel {
+    std::atomic<std::shared_ptr<const Field>> field;
+    std::atomic<uint64_t> version{0}; // incremented after each replacement, to check for a new level cheaply.
+
+    void publish(Field newField) {
+        field.store(std::make_shared<const Field>(std::move(newField)), std::memory_order_release);
+        version.fetch_add(1, std::memory_order_release);
+    }
+    [[nodiscard]] auto current() const -> std::shared_ptr<const Field> {
+        return field.load(std::memory_order_acquire);
+    }
+};
+
+// Watches a file with inotify and calls `onChange` in its own thread after the file was written.
+// The directory is watched, so an editor that replaces the file with a new one is noticed as well.
+// The events of one save often come in a burst, so `onChange` is only called when the directory
+// has been quiet for `cSettleTime`.
+struct FileWatcher {
+    constexpr static auto cSettleTime = std::chrono::milliseconds{100};
+    constexpr static uint32_t cEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+    std::filesystem::path path;
+    std::function<void()> onChange;
+    int inotify{-1};
+    int stopEvent{-1};
+    std::thread thread;
+
+    FileWatcher(std::filesystem::path watchedPath, std::function<void()> changeHandler)
+            : path{std::move(watchedPath)}, onChange{std::move(changeHandler)} {
+        inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        stopEvent = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        auto directory = path.parent_path();
+        if (directory.empty()) { directory = "."; }
+        if (inotify < 0 || stopEvent < 0 || ::inotify_add_watch(inotify, directory.c_str(), cEvents) < 0) {
+            const auto error = errno;
+            closeFiles();
+            throw std::system_error{error, std::generic_category(), "Could not watch " + path.string()};
+        }
+        // The thread blocks all signals, like the threads of the server, which read them with a `signalfd`.
+        sigset_t allSignals;
+        sigset_t previousSignals;
+        sigfillset(&allSignals);
+        ::pthread_sigmask(SIG_BLOCK, &allSignals, &previousSignals);
+        thread = std::thread{[this] { run(); }};
+        ::pthread_sigmask(SIG_SETMASK, &previousSignals, nullptr);
+    }
+    ~FileWatcher() {
+        const uint64_t one = 1;
+        [[maybe_unused]] const auto written = ::write(stopEvent, &one, sizeof(one));
+        thread.join();
+        closeFiles();
+    }
+    FileWatcher(const FileWatcher&) = delete;
+    auto operator=(const FileWatcher&) -> FileWatcher& = delete;
+
+    void closeFiles() noexcept {
+        if (inotify >= 0) { ::close(inotify); }
+        if (stopEvent >= 0) { ::close(stopEvent); }
+    }
+
+    /// Read all pending events. @return `true` if one of them is about the watched file.
+    [[nodiscard]] auto readEvents() const noexcept -> bool {
+        alignas(inotify_event) std::array<char, 4096> buffer{};
+        const auto fileName = path.filename().string();
+        auto isChanged = false;
+        while (true) {
+            const auto length = ::read(inotify, buffer.data(), buffer.size());
+            if (length <= 0) { return isChanged; }
+            for (std::size_t offset = 0; offset < static_cast<std::size_t>(length);) {
+                const auto *event = reinterpret_cast<const inotify_event*>(buffer.data() + offset);
+                if (event->len > 0 && fileName == event->name) { isChanged = true; }
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+
+    /// Wait for the next event. @return `false` if the watcher is stopped.
+    [[nodiscard]] auto wait(int timeoutMilliseconds, bool &hasEvent) const noexcept -> bool {
+        auto files = std::array{pollfd{.fd = inotify, .events = POLLIN, .revents = 0},
+            pollfd{.fd = stopEvent, .events = POLLIN, .revents = 0}};
+        const auto count = ::poll(files.data(), files.size(), timeoutMilliseconds);
+        hasEvent = count > 0 && (files[0].revents & POLLIN) != 0;
+        return count < 0 ? errno == EINTR : (files[1].revents & POLLIN) == 0;
+    }
+
+    void run() {
+        auto hasEvent = false;
+        while (wait(-1, hasEvent)) {
+            if (!hasEvent || !readEvents()) { continue; }
+            while (true) {
+                if (!wait(static_cast<int>(cSettleTime.count()), hasEvent)) { return; }
+                if (!hasEvent) { break; }
+                [[maybe_unused]] const auto isChanged = readEvents();
+            }
+            onChange();
+        }
+    }
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "GameServer.hpp"
+#include "Profiler.hpp"
+#include "Simulation.hpp"
+#include "World.hpp"
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A client of the test: it keeps a copy of the world from the state lines of the server, and
+// chooses its moves with a `PlayerController` like the simulation.
+struct LoadTestClient {
+    int socket{-1};
+    World world;
+    PlayerController controller;
+    std::string input; // received bytes, up to the end of the last complete line.
+    int turns{};
+    std::chrono::steady_clock::time_point moveTime; // when the last move was sent.
+};
+
+// Plays `games` games on a server with many concurrent clients from one epoll loop. Each client
+// sends one move and waits for the answer, so the time until the answer is the latency of a move.
+struct LoadTest {
+    Field field;
+    ServerAddress address;
+    int clientCount{100};
+    uint64_t games{10000};
+    PlayerPolicy playerPolicy{PlayerPolicy::BfsToExit};
+    int maxTurns{1000}; // a game that takes longer is counted as timeout and restarted.
+
+    SimulationStatistics statistics;
+    ProfileHistogram moveLatency;
+    uint64_t startedGames{};
+    uint64_t moves{};
+
+    // Reads the numbers of a line, one after the other.
+    struct LineReader {
+        std::string_view text;
+
+        [[nodiscard]] auto next() -> int {
+            while (!text.empty() && text.front() == ' ') { text.remove_prefix(1); }
+            int value{};
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (error != std::errc{}) { throw std::runtime_error{"Invalid message from the server."}; }
+            text.remove_prefix(static_cast<std::size_t>(end - text.data()));
+            return value;
+        }
+        [[nodiscard]] auto nextPosition() -> Position {
+            const auto x = next();
+            return Position{x, next()};
+        }
+    };
+
+    static void send(LoadTestClient &client, char command) {
+        if (::send(client.socket, &command, 1, MSG_NOSIGNAL) != 1) { throwSystemError("Could not send a command"); }
+    }
+
+    void sendMove(LoadTestClient &client) {
+        const auto input = client.controller.nextInput(client.world);
+        client.moveTime = std::chrono::steady_clock::now();
+        send(client, GameProtocol::cMoveCommands[ReplayGame::moveFromInput(input)]);
+    }
+
+    /// @return `false` if the client has finished.
+    auto startGame(LoadTestClient &client, std::string_view line) -> bool {
+        auto reader = LineReader{line.substr(1)};
+        [[maybe_unused]] const auto gameIndex = reader.next();
+        client.turns = reader.next();
+        auto &world = client.world;
+        world.clearElements();
+        for (auto exitCount = reader.next(); exitCount > 0; --exitCount) {
+            world.exits.emplace_back(Exit{reader.nextPosition()});
+        }
+        world.player.pos = reader.nextPosition();
+        for (auto robotCount = reader.next(); robotCount > 0; --robotCount) {
+            world.addRobot(reader.nextPosition());
+        }
+        if (startedGames == games) {
+            send(client, GameProtocol::cQuitCommand);
+            return false;
+        }
+        ++startedGames;
+        client.controller.startGame(world, Random{startedGames});
+        sendMove(client);
+        return true;
+    }
+
+    void advanceGame(LoadTestClient &client, std::string_view line) {
+        const auto latency = std::chrono::steady_clock::now() - client.moveTime;
+        moveLatency.add(static_cast<uint64_t>(std::chrono::nanoseconds{latency}.count()), 0);
+        ++moves;
+        auto reader = LineReader{line.substr(1)};
+        client.turns = reader.next();
+        client.world.player.moveTo(reader.nextPosition());
+        for (auto movedCount = reader.next(); movedCount > 0; --movedCount) {
+            const auto robotIndex = static_cast<std::size_t>(reader.next());
+            if (robotIndex >= client.world.robots.size()) { throw std::runtime_error{"Invalid message from the server."}; }
+            client.world.moveRobot(robotIndex, reader.nextPosition());
+        }
+        const auto stateCode = line.back();
+        if (stateCode != GameProtocol::stateCode(GameState::Running)) {
+            statistics.addGame(stateCode == GameProtocol::stateCode(GameState::PlayerWon)
+                ? GameState::PlayerWon : GameState::RobotsWon, client.turns);
+            return; // the server starts the next game.
+        }
+        if (client.turns >= maxTurns) {
+            statistics.addGame(GameState::Running, client.turns);
+            send(client, GameProtocol::cNewGameCommand);
+            return;
+        }
+        sendMove(client);
+    }
+
+    /// @return `false` if the client has finished.
+    auto handleLines(LoadTestClient &client) -> bool {
+        std::size_t lineStart = 0;
+        for (auto lineEnd = client.input.find('\n'); lineEnd != std::string::npos; lineEnd = client.input.find('\n', lineStart)) {
+            const auto line = std::string_view{client.input}.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+            if (line.starts_with('G') && !startGame(client, line)) { return false; }
+            if (line.starts_with('T')) { advanceGame(client, line); }
+        }
+        client.input.erase(0, lineStart);
+        return true;
+    }
+
+    void run() {
+        const auto epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll < 0) { throwSystemError("Could not create an event loop"); }
+        std::vector<LoadTestClient> clients(static_cast<std::size_t>(clientCount),
+            LoadTestClient{.world = World{field}, .controller = PlayerController{playerPolicy}});
+        for (std::size_t i = 0; i < clients.size(); ++i) {
+            clients[i].socket = address.connect();
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = i;
+            if (::epoll_ctl(epoll, EPOLL_CTL_ADD, clients[i].socket, &event) != 0) { throwSystemError("Could not watch a socket"); }
+        }
+        auto openClients = clients.size();
+        std::array<epoll_event, 256> events{};
+        std::array<char, 4096> buffer{};
+        while (openClients > 0) {
+            const auto eventCount = ::epoll_wait(epoll, events.data(), static_cast<int>(events.size()), -1);
+            if (eventCount < 0 && errno == EINTR) { continue; }
+            if (eventCount < 0) { throwSystemError("The event loop failed"); }
+            for (int i = 0; i < eventCount; ++i) {
+                auto &client = clients[events[i].data.u64];
+                const auto received = ::recv(client.socket, buffer.data(), buffer.size(), 0);
+                if (received < 0 && (errno == EAGAIN || errno == EINTR)) { continue; }
+                if (received <= 0) { throw std::runtime_error{"The server closed the connection."}; }
+                client.input.append(buffer.data(), static_cast<std::size_t>(received));
+                if (!handleLines(client)) {
+                    ::close(client.socket);
+                    client.socket = -1;
+                    --openClients;
+                }
+            }
+        }
+        ::close(epoll);
+    }
+};
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "Canvas.hpp"
+#include "DistanceField.hpp"
+#include "Profiler.hpp"
 #include "World.hpp"
 
+#include <array>
 #include <iostream>
-#include <map>
 #include <string>
 #include <vector>
 #include <limits>
@@ -17,25 +19,30 @@ struct PlayerInput {
 };
 
 constexpr auto cQuitInput = PlayerInput{Position{99, 99}};
+constexpr auto cUndoInput = PlayerInput{Position{98, 98}};
+
+/// The input for a key of the console game, or an empty input for any other key.
+[[nodiscard]] constexpr auto inputFromKey(char key) noexcept -> PlayerInput {
+    switch (key) {
+    case 'e': return PlayerInput{Position{1, 0}};
+    case 's': return PlayerInput{Position{0, 1}};
+    case 'w': return PlayerInput{Position{-1, 0}};
+    case 'n': return PlayerInput{Position{0, -1}};
+    case 'u': return cUndoInput;
+    case 'q': return cQuitInput;
+    default: return PlayerInput{};
+    }
+}
 
 [[nodiscard]] inline auto inputFromConsole() noexcept -> PlayerInput {
-    static const auto validInputs = std::map<std::string, PlayerInput>{
-        {"e", {Position{1, 0}}},
-        {"s", {Position{0, 1}}},
-        {"w", {Position{-1, 0}}},
-        {"n", {Position{0, -1}}},
-        {"q", cQuitInput},
-    };
     PlayerInput playerInput;
+    std::string input;
     while (playerInput == PlayerInput{}) {
-        std::cout << "Enter your move (n/e/s/w/q=quit): ";
+        std::cout << "Enter your move (n/e/s/w/u=undo/q=quit): ";
         std::cout.flush();
-        std::string input;
         std::getline(std::cin, input);
-        auto it = validInputs.find(input);
-        if (it != validInputs.end()) {
-            playerInput = it->second;
-        } else {
+        if (input.size() == 1) { playerInput = inputFromKey(input.front()); }
+        if (playerInput == PlayerInput{}) {
             std::cout << "Invalid input. Please try again.\n";
         }
     }
@@ -49,31 +56,88 @@ enum class GameState {
 };
 
 struct PlayerLogic {
-    void advance(PlayerInput input, World &world) {
+    /// An empty input waits a turn, without touching the trail of the player.
+    /// @return `false` if the player did not move, or could not move in the requested direction.
+    auto advance(PlayerInput input, World &world) noexcept -> bool {
+        const auto profileScope = ProfileScope{ProfilePoint::PlayerAdvance};
+        if (input == PlayerInput{}) { return false; }
         auto newPlayerPos = world.player.pos + input.movement;
-        if (world.isValidPlayerMovement(newPlayerPos)) {
-            world.player.moveTo(newPlayerPos);
-        } else {
-            std::cout << "Could not move in this direction. You lost one move.\n";
-        }
+        if (!world.isValidPlayerMovement(newPlayerPos)) { return false; }
+        world.player.moveTo(newPlayerPos);
+        return true;
     }
 };
 
+enum class RobotStrategy {
+    Greedy,    ///< Step towards the player by Manhattan distance, ignoring walls.
+    FlowField, ///< Follow a shared breadth-first distance map from the player around walls.
+};
+
 struct RobotLogic {
-    void advance(Robot &robot, World &world) {
-        if (robot.pos == world.player.pos) { return; }
+    /// The flow field only covers this many cells around the player, so its cost per turn does not
+    /// depend on the field size. Robots outside of it, or cut off inside of it, move greedily.
+    constexpr static int cFlowFieldRadius = 64;
+
+    RobotStrategy strategy{RobotStrategy::Greedy};
+    Random random;
+    DistanceField distanceToPlayer;
+
+    void prepareTurn(const World &world) {
+        if (strategy == RobotStrategy::FlowField) {
+            const auto region = Rectangle{world.player.pos, Size{1, 1}}.padded(cFlowFieldRadius, cFlowFieldRadius);
+            distanceToPlayer.update(world.field, world.player.pos, region);
+        }
+    }
+
+    [[nodiscard]] auto usesFlowField(const Robot &robot) const noexcept -> bool {
+        return strategy == RobotStrategy::FlowField
+            && distanceToPlayer.distanceAt(robot.pos) != DistanceField::cUnreachable;
+    }
+
+    [[nodiscard]] auto distanceFrom(Position pos, bool flowField, const World &world) const noexcept -> int {
+        if (flowField) {
+            return distanceToPlayer.distanceAt(pos);
+        }
+        return pos.distanceTo(world.player.pos);
+    }
+
+    /// The moves that bring the robot closest to the player, the robot picks one of them at random.
+    /// @return The number of moves in `bestMoves`, zero if the robot stays where it is.
+    [[nodiscard]] auto bestMoves(const Robot &robot, const World &world,
+            std::array<Position, cPosDelta4.size()> &bestMoves) const noexcept -> int {
+        if (robot.pos == world.player.pos) { return 0; }
         int bestDistance = std::numeric_limits<int>::max();
-        std::vector<Position> bestMoves;
+        int bestMoveCount = 0;
+        const auto flowField = usesFlowField(robot);
         for (auto delta : cPosDelta4) {
             auto pos = robot.pos + delta;
             if (!world.isValidRobotMovement(pos)) continue;
-            auto dist = pos.distanceTo(world.player.pos);
-            if (dist < bestDistance) { bestMoves = {pos}; bestDistance = dist; }
-            else if (dist == bestDistance) { bestMoves.push_back(pos); }
+            auto dist = distanceFrom(pos, flowField, world);
+            if (dist == DistanceField::cUnreachable) continue;
+            if (dist < bestDistance) { bestMoveCount = 0; bestDistance = dist; }
+            if (dist == bestDistance) { bestMoves[bestMoveCount++] = pos; }
         }
-        if (bestMoves.empty()) return;
-        robot.moveTo(bestMoves[randomInt(0, bestMoves.size() - 1)]);
+        return bestMoveCount;
     }
+
+    void advance(std::size_t robotIndex, World &world) {
+        const auto profileScope = ProfileScope{ProfilePoint::RobotAdvance};
+        std::array<Position, cPosDelta4.size()> moves;
+        const auto moveCount = bestMoves(world.robots[robotIndex], world, moves);
+        if (moveCount == 0) return;
+        world.moveRobot(robotIndex, moves[random.nextInt(0, moveCount - 1)]);
+    }
+};
+
+// The state of a game that changes from turn to turn. The field is not part of it: it never changes
+// during a game, so all snapshots of a game share the field of its `Logic`. The elements are
+// trivially copyable, so saving into a snapshot that is reused copies flat memory, without allocations.
+struct GameSnapshot {
+    Player player;
+    std::vector<Robot> robots;
+    std::vector<Exit> exits;
+    Random worldRandom;
+    Random robotRandom;
 };
 
 struct Logic {
@@ -81,13 +145,47 @@ struct Logic {
     PlayerLogic playerLogic;
     RobotLogic robotLogic;
 
-    explicit Logic(World &&initialWorld) : world{std::move(initialWorld)} {}
+    explicit Logic(World &&initialWorld, RobotStrategy robotStrategy = RobotStrategy::Greedy)
+        : world{std::move(initialWorld)}, robotLogic{robotStrategy} {}
 
-    void advance(PlayerInput input) {
-        playerLogic.advance(input, world);
-        for (auto &robot : world.robots) {
-            robotLogic.advance(robot, world);
+    /// Place new elements on the field. All randomness of the game is derived from `gameRandom`.
+    void startGame(Random gameRandom, int robotCount) {
+        const auto profileScope = ProfileScope{ProfilePoint::StartGame};
+        world.clearElements();
+        world.random = gameRandom.split();
+        robotLogic.random = gameRandom.split();
+        world.populate(robotCount);
+    }
+
+    /// @return `false` if the player could not move in the requested direction.
+    auto advance(PlayerInput input) -> bool {
+        const auto profileScope = ProfileScope{ProfilePoint::Turn};
+        const auto playerMoved = playerLogic.advance(input, world);
+        robotLogic.prepareTurn(world);
+        for (std::size_t robotIndex = 0; robotIndex < world.robots.size(); ++robotIndex) {
+            robotLogic.advance(robotIndex, world);
         }
+        return playerMoved;
+    }
+
+    /// Save the state of the game into `snapshot`, reusing its memory.
+    void saveSnapshot(GameSnapshot &snapshot) const {
+        snapshot.player = world.player;
+        snapshot.robots.assign(world.robots.begin(), world.robots.end());
+        snapshot.exits.assign(world.exits.begin(), world.exits.end());
+        snapshot.worldRandom = world.random;
+        snapshot.robotRandom = robotLogic.random;
+    }
+    [[nodiscard]] auto snapshot() const -> GameSnapshot {
+        GameSnapshot result;
+        saveSnapshot(result);
+        return result;
+    }
+    /// Continue the game from a snapshot of this game. The same inputs lead to the same turns again.
+    void restore(const GameSnapshot &snapshot) {
+        world.setElements(snapshot.player, snapshot.robots, snapshot.exits);
+        world.random = snapshot.worldRandom;
+        robotLogic.random = snapshot.robotRandom;
     }
 
     [[nodiscard]] auto gameState() const noexcept -> GameState {
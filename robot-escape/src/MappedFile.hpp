@@ -0,0 +1,42 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+// A read-only memory mapping of a whole file.
+struct MappedFile {
+    void *address{MAP_FAILED};
+    std::size_t size{};
+
+    explicit MappedFile(const std::filesystem::path &path) {
+        const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { throw std::runtime_error{"Could not open file " + path.string()}; }
+        struct stat status{};
+        if (::fstat(fd, &status) != 0 || status.st_size <= 0) {
+            ::close(fd);
+            throw std::runtime_error{"Could not read the size of file " + path.string()};
+        }
+        size = static_cast<std::size_t>(status.st_size);
+        address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) { throw std::runtime_error{"Could not map file " + path.string()}; }
+    }
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile& = delete;
+    ~MappedFile() {
+        if (address != MAP_FAILED) { ::munmap(address, size); }
+    }
+
+    [[nodiscard]] auto bytes() const noexcept -> std::span<const std::byte> {
+        return {static_cast<const std::byte*>(address), size};
+    }
+};
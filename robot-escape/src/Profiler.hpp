@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The instrumentation is only built if `ROBOT_ESCAPE_PROFILING` is defined (CMake option of the same name).
+// Without it, `ProfileScope` is an empty type and all measurements are removed by the compiler.
+#ifdef ROBOT_ESCAPE_PROFILING
+constexpr bool cProfilingEnabled = true;
+#else
+constexpr bool cProfilingEnabled = false;
+#endif
+
+enum class ProfilePoint : uint8_t {
+    ReadConfiguration,
+    BuildField,
+    StartGame,
+    Turn,
+    PlayerAdvance,
+    RobotAdvance,
+    WorldRender,
+    ConsoleRender,
+};
+
+constexpr auto cProfilePointNames = std::array<std::string_view, 8>{
+    "read_configuration",
+    "build_field",
+    "start_game",
+    "turn",
+    "player_advance",
+    "robot_advance",
+    "world_render",
+    "console_render",
+};
+
+// A log-linear histogram of durations in nanoseconds. Values below 16 get their own bucket, larger
+// values are split into 8 buckets per power of two, so a percentile is off by at most 12.5%.
+struct ProfileHistogram {
+    constexpr static int cSubBucketBits = 3;
+    constexpr static int cLinearLimit = 2 << cSubBucketBits;
+    constexpr static int cBucketCount = cLinearLimit + (64 - cSubBucketBits - 1) * (1 << cSubBucketBits);
+
+    std::array<uint64_t, cBucketCount> counts{};
+    uint64_t calls{};
+    uint64_t totalNanoseconds{};
+    uint64_t maxNanoseconds{};
+    uint64_t allocations{};
+
+    [[nodiscard]] static auto bucketIndex(uint64_t value) noexcept -> int {
+        if (value < cLinearLimit) { return static_cast<int>(value); }
+        const auto exponent = std::bit_width(value) - 1;
+        const auto subBucket = static_cast<int>((value >> (exponent - cSubBucketBits)) & ((1U << cSubBucketBits) - 1));
+        return cLinearLimit + (exponent - cSubBucketBits - 1) * (1 << cSubBucketBits) + subBucket;
+    }
+    /// The largest value that is counted in the bucket.
+    [[nodiscard]] static auto bucketLimit(int index) noexcept -> uint64_t {
+        if (index < cLinearLimit) { return static_cast<uint64_t>(index); }
+        const auto exponent = (index - cLinearLimit) / (1 << cSubBucketBits) + cSubBucketBits + 1;
+        const auto subBucket = static_cast<uint64_t>((index - cLinearLimit) % (1 << cSubBucketBits));
+        const auto step = uint64_t{1} << (exponent - cSubBucketBits);
+        return (uint64_t{1} << exponent) + (subBucket + 1) * step - 1;
+    }
+
+    void add(uint64_t nanoseconds, uint64_t allocationCount) noexcept {
+        ++counts[bucketIndex(nanoseconds)];
+        ++calls;
+        totalNanoseconds += nanoseconds;
+        maxNanoseconds = std::max(maxNanoseconds, nanoseconds);
+        allocations += allocationCount;
+    }
+    void merge(const ProfileHistogram &other) noexcept {
+        for (int i = 0; i < cBucketCount; ++i) {
+            counts[i] += other.counts[i];
+        }
+        calls += other.calls;
+        totalNanoseconds += other.totalNanoseconds;
+        maxNanoseconds = std::max(maxNanoseconds, other.maxNanoseconds);
+        allocations += other.allocations;
+    }
+    /// @param fraction The fraction of calls that took at most the returned time, e.g. `0.99`.
+    [[nodiscard]] auto percentile(double fraction) const noexcept -> uint64_t {
+        const auto rank = static_cast<uint64_t>(fraction * static_cast<double>(calls) + 0.5);
+        uint64_t seen = 0;
+        for (int i = 0; i < cBucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= std::max<uint64_t>(rank, 1)) { return std::min(bucketLimit(i), maxNanoseconds); }
+        }
+        return maxNanoseconds;
+    }
+};
+
+struct ProfileData {
+    std::array<ProfileHistogram, cProfilePointNames.size()> histograms;
+};
+
+// Collects the measurements. Every thread records into its own `ProfileData`, so measuring needs
+// no locks. The data is owned here and outlives the threads, so it can be reported at exit.
+struct Profiler {
+    inline static bool isEnabled{false}; // set once, before any other thread is started.
+    inline static thread_local uint64_t allocationCount{}; // counted by the `operator new` in `AllocationCounter.cpp`.
+    inline static std::mutex mutex;
+    inline static std::vector<std::unique_ptr<ProfileData>> threadData;
+
+    static void countAllocation() noexcept {
+        if constexpr (cProfilingEnabled) { ++allocationCount; }
+    }
+
+    [[nodiscard]] static auto dataForThisThread() -> ProfileData& {
+        thread_local ProfileData *data = [] {
+            const auto lock = std::scoped_lock{mutex};
+            return threadData.emplace_back(std::make_unique<ProfileData>()).get();
+        }();
+        return *data;
+    }
+
+    static void record(ProfilePoint point, uint64_t nanoseconds, uint64_t allocations) {
+        dataForThisThread().histograms[static_cast<std::size_t>(point)].add(nanoseconds, allocations);
+    }
+
+    /// Call this after all measured threads have finished.
+    [[nodiscard]] static auto summary() -> ProfileData {
+        const auto lock = std::scoped_lock{mutex};
+        ProfileData result;
+        for (const auto &data : threadData) {
+            for (std::size_t i = 0; i < result.histograms.size(); ++i) {
+                result.histograms[i].merge(data->histograms[i]);
+            }
+        }
+        return result;
+    }
+
+    [[nodiscard]] static auto summaryAsText(const ProfileData &data) -> std::string {
+        auto text = std::format("{:<20} {:>12} {:>12} {:>12} {:>12} {:>12} {:>12}\n",
+            "Profile", "calls", "total ms", "p50 µs", "p99 µs", "max µs", "allocations");
+        for (std::size_t i = 0; i < data.histograms.size(); ++i) {
+            const auto &histogram = data.histograms[i];
+            if (histogram.calls == 0) { continue; }
+            text += std::format("{:<20} {:>12} {:>12.3f} {:>12.3f} {:>12.3f} {:>12.3f} {:>12}\n",
+                cProfilePointNames[i], histogram.calls,
+                static_cast<double>(histogram.totalNanoseconds) / 1e6,
+                static_cast<double>(histogram.percentile(0.5)) / 1e3,
+                static_cast<double>(histogram.percentile(0.99)) / 1e3,
+                static_cast<double>(histogram.maxNanoseconds) / 1e3,
+                histogram.allocations);
+        }
+        return text;
+    }
+
+    [[nodiscard]] static auto summaryAsJson(const ProfileData &data) -> std::string {
+        std::string json = "{\n  \"unit\": \"ns\",\n  \"points\": [";
+        bool isFirst = true;
+        for (std::size_t i = 0; i < data.histograms.size(); ++i) {
+            const auto &histogram = data.histograms[i];
+            if (histogram.calls == 0) { continue; }
+            json += std::format("{}\n    {{\"name\": \"{}\", \"calls\": {}, \"total\": {}, \"p50\": {}, \"p99\": {}, "
+                "\"max\": {}, \"allocations\": {}}}",
+                isFirst ? "" : ",", cProfilePointNames[i], histogram.calls, histogram.totalNanoseconds,
+                histogram.percentile(0.5), histogram.percentile(0.99), histogram.maxNanoseconds,
+                histogram.allocations);
+            isFirst = false;
+        }
+        json += "\n  ]\n}\n";
+        return json;
+    }
+};
+
+template<bool tEnabled>
+struct BasicProfileScope;
+
+/// Measures the time and the allocations from construction to destruction, if `--profile` is set.
+template<>
+struct BasicProfileScope<true> {
+    ProfilePoint point;
+    bool isActive{Profiler::isEnabled};
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t startAllocations{};
+
+    explicit BasicProfileScope(ProfilePoint point) noexcept : point{point} {
+        if (!isActive) { return; }
+        startAllocations = Profiler::allocationCount;
+        startTime = std::chrono::steady_clock::now();
+    }
+    ~BasicProfileScope() {
+        if (!isActive) { return; }
+        const auto duration = std::chrono::steady_clock::now() - startTime;
+        Profiler::record(point, static_cast<uint64_t>(std::chrono::nanoseconds{duration}.count()),
+            Profiler::allocationCount - startAllocations);
+    }
+    BasicProfileScope(const BasicProfileScope&) = delete;
+    auto operator=(const BasicProfileScope&) -> BasicProfileScope& = delete;
+};
+
+template<>
+struct BasicProfileScope<false> {
+    constexpr explicit BasicProfileScope(ProfilePoint) noexcept {}
+    ~BasicProfileScope() {} // user-provided, so an unused scope variable causes no warning.
+};
+
+using ProfileScope = BasicProfileScope<cProfilingEnabled>;
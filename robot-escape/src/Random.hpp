@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+
+// A small SplitMix64 generator. It is cheap to copy and seed, and `split`/`stream` derive independent
+// generators, so every game and every consumer in a game can get its own reproducible sequence.
+struct Random {
+    constexpr static std::uint64_t cGoldenGamma = 0x9e3779b97f4a7c15ULL;
+    constexpr static std::uint64_t cSplitSalt = 0x5851f42d4c957f2dULL;
+
+    std::uint64_t state{};
+
+    Random() = default;
+    explicit constexpr Random(std::uint64_t seed) noexcept : state{seed} {}
+
+    [[nodiscard]] static auto seedFromEntropy() -> std::uint64_t {
+        std::random_device device;
+        return (static_cast<std::uint64_t>(device()) << 32) ^ device();
+    }
+    [[nodiscard]] constexpr static auto mix(std::uint64_t value) noexcept -> std::uint64_t {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+    constexpr auto next() noexcept -> std::uint64_t {
+        state += cGoldenGamma;
+        return mix(state);
+    }
+    /// A uniform integer in the closed range `[minimum, maximum]`.
+    constexpr auto nextInt(int minimum, int maximum) noexcept -> int {
+        const auto range = static_cast<std::uint64_t>(static_cast<std::int64_t>(maximum) - minimum + 1);
+        return minimum + static_cast<int>(((next() >> 32) * range) >> 32);
+    }
+    /// A new generator, independent of the sequence that this generator continues with.
+    [[nodiscard]] constexpr auto split() noexcept -> Random {
+        return Random{mix(next() ^ cSplitSalt)};
+    }
+    /// The generator for stream `index`, derived without advancing this generator.
+    [[nodiscard]] constexpr auto stream(std::uint64_t index) const noexcept -> Random {
+        return Random{mix(state ^ mix((index + 1) * cGoldenGamma))};
+    }
+};
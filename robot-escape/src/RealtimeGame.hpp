@@ -0,0 +1,153 @@
+#pragma once
+
+#include "Canvas.hpp"
+#include "ConsoleRenderer.hpp"
+#include "Logic.hpp"
+#include "Profiler.hpp"
+#include "Terminal.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+// A frame of the real-time game, as it is passed from the game loop to the render thread.
+struct RealtimeFrame {
+    Canvas canvas = Canvas{};
+    std::string status; // the line below the canvas.
+    std::chrono::steady_clock::time_point inputTime; // when the key shown in this frame was read, or zero.
+};
+
+// Passes the newest frame to the render thread. Publishing never waits for the console: a frame
+// that was not rendered yet is replaced, and only the time of its key is kept. The frames are
+// swapped, so their memory is reused.
+struct FrameMailbox {
+    std::mutex mutex;
+    std::condition_variable changed;
+    RealtimeFrame frame;
+    bool hasFrame{};
+    bool isClosed{};
+    uint64_t droppedFrames{};
+
+    /// Swap `next` into the mailbox. Afterwards, `next` holds an older frame.
+    void publish(RealtimeFrame &next) {
+        {
+            const auto lock = std::scoped_lock{mutex};
+            if (hasFrame) {
+                ++droppedFrames;
+                if (frame.inputTime != std::chrono::steady_clock::time_point{}) { next.inputTime = frame.inputTime; }
+            }
+            std::swap(frame, next);
+            hasFrame = true;
+        }
+        changed.notify_one();
+    }
+
+    /// Wait for a new frame and swap it into `current`.
+    /// @return `false` if the mailbox was closed and the last frame was taken.
+    auto take(RealtimeFrame &current) -> bool {
+        auto lock = std::unique_lock{mutex};
+        changed.wait(lock, [&] { return hasFrame || isClosed; });
+        if (!hasFrame) { return false; }
+        std::swap(frame, current);
+        hasFrame = false;
+        return true;
+    }
+
+    void close() {
+        {
+            const auto lock = std::scoped_lock{mutex};
+            isClosed = true;
+        }
+        changed.notify_one();
+    }
+};
+
+// Plays a game in real time. The robots move once per tick, also if no key is pressed, and each
+// key moves the player at once, together with a robot turn, and starts a new tick. The console
+// is written by a separate thread, so a slow console drops frames but never delays a turn.
+struct RealtimeGame {
+    using Clock = std::chrono::steady_clock;
+
+    Logic &logic;
+    ConsoleRenderer &renderer; // only used by the render thread.
+    Size canvasSize;
+    Clock::duration tickTime{std::chrono::milliseconds{250}};
+
+    ProfileHistogram inputLatency; // from reading a key until the frame with its turn was written.
+    uint64_t turns{};
+    uint64_t droppedFrames{};
+
+    void renderFrames(FrameMailbox &mailbox) {
+        auto frame = RealtimeFrame{.canvas = Canvas{canvasSize}};
+        while (mailbox.take(frame)) {
+            ConsoleRenderer::writeToConsole(renderer.render(frame.canvas));
+            ConsoleRenderer::writeToConsole(frame.status);
+            if (frame.inputTime != Clock::time_point{}) {
+                const auto latency = std::chrono::nanoseconds{Clock::now() - frame.inputTime};
+                inputLatency.add(static_cast<uint64_t>(latency.count()), 0);
+            }
+        }
+    }
+
+    /// @return The state at the end of the game, `GameState::Running` if the player quit.
+    auto run(RawTerminal &terminal) -> GameState {
+        // All frames have the size of the canvas, as they are swapped between the threads.
+        auto mailbox = FrameMailbox{.frame = RealtimeFrame{.canvas = Canvas{canvasSize}}};
+        auto frame = RealtimeFrame{.canvas = Canvas{canvasSize}};
+        std::string_view message;
+        auto publishFrame = [&](Clock::time_point inputTime) {
+            frame.canvas.clear();
+            logic.render(frame.canvas);
+            frame.status.clear();
+            std::format_to(std::back_inserter(frame.status),
+                "Turn {}. Move with the arrow keys or n/e/s/w, q to quit. {}\n", turns, message);
+            frame.inputTime = inputTime;
+            mailbox.publish(frame);
+        };
+        auto state = logic.gameState();
+        auto playTurn = [&](PlayerInput input, Clock::time_point inputTime) {
+            const auto playerMoved = logic.advance(input);
+            if (input != PlayerInput{}) { message = playerMoved ? "" : "Could not move in this direction."; }
+            ++turns;
+            state = logic.gameState();
+            publishFrame(inputTime);
+        };
+        auto renderThread = std::thread{[&] { renderFrames(mailbox); }};
+        publishFrame({});
+        auto decoder = KeyDecoder{};
+        auto hasQuit = false;
+        auto deadline = Clock::now() + tickTime;
+        while (state == GameState::Running && !hasQuit) {
+            const auto bytes = terminal.read(deadline);
+            const auto readTime = Clock::now();
+            for (const auto byte : bytes) {
+                const auto input = decoder.feed(byte);
+                if (input == cQuitInput) {
+                    hasQuit = true;
+                    break;
+                }
+                if (input == PlayerInput{} || input == cUndoInput) { continue; }
+                playTurn(input, readTime);
+                deadline = readTime + tickTime;
+                if (state != GameState::Running) { break; }
+            }
+            if (state == GameState::Running && !hasQuit && Clock::now() >= deadline) {
+                playTurn(PlayerInput{}, {});
+                deadline += tickTime;
+                // After a stall, e.g. while the process was stopped, the missed ticks are skipped.
+                if (const auto now = Clock::now(); deadline <= now) { deadline = now + tickTime; }
+            }
+        }
+        mailbox.close();
+        renderThread.join();
+        droppedFrames = mailbox.droppedFrames;
+        return state;
+    }
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include "Field.hpp"
+#include "Logic.hpp"
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A replay: the header, followed by one record per game. Game `n` of a replay is started with
+// `Random{seed}.stream(n)`, so only the inputs of the player need to be stored. A record is:
+// - the game index as varint,
+// - `turnCount << 2 | finalState` as varint,
+// - `(turnCount + 3) / 4` bytes with the moves, two bits each, starting with the low bits.
+// A move is the index of the direction in `cPosDelta4`.
+struct ReplayFileHeader {
+    constexpr static std::array<char, 8> cMagic = {'R', 'O', 'B', 'O', 'R', 'E', 'P', '\0'};
+    constexpr static uint32_t cVersion = 1;
+    constexpr static uint32_t cByteOrderMark = 0x01020304U;
+
+    std::array<char, 8> magic{cMagic};
+    uint32_t version{cVersion};
+    uint32_t byteOrderMark{cByteOrderMark};
+    uint64_t seed{};
+    uint64_t levelHash{}; // `ReplayFile::levelHash` of the field the games were played on.
+    uint32_t robotCount{};
+    uint32_t robotStrategy{}; // `RobotStrategy`
+};
+
+// The moves of one game, one direction index per turn.
+struct ReplayGame {
+    uint64_t index{};
+    GameState finalState{GameState::Running};
+    std::vector<uint8_t> moves;
+
+    [[nodiscard]] static auto moveFromInput(PlayerInput input) noexcept -> uint8_t {
+        return static_cast<uint8_t>(std::ranges::find(cPosDelta4, input.movement) - cPosDelta4.begin());
+    }
+    [[nodiscard]] static auto inputFromMove(uint8_t move) noexcept -> PlayerInput {
+        return PlayerInput{cPosDelta4[move & 3U]};
+    }
+    void clear(uint64_t gameIndex) noexcept {
+        index = gameIndex;
+        finalState = GameState::Running;
+        moves.clear();
+    }
+};
+
+// Writes whole blocks of records to the file. It is shared by all threads of a simulation,
+// each one encodes its games into a `ReplayRecorder` first.
+struct ReplayWriter {
+    std::ofstream file;
+    std::filesystem::path path;
+    std::mutex mutex;
+
+    ReplayWriter(const std::filesystem::path &path, const ReplayFileHeader &header)
+        : file{path, std::ios::binary | std::ios::trunc}, path{path} {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!file) { throw std::runtime_error{"Could not write replay file " + path.string()}; }
+    }
+
+    // Called from the simulation threads, so errors are only reported by `finish`.
+    void writeBlock(std::span<const uint8_t> block) {
+        const auto lock = std::scoped_lock{mutex};
+        file.write(reinterpret_cast<const char*>(block.data()), static_cast<std::streamsize>(block.size()));
+    }
+
+    void finish() {
+        file.flush();
+        if (!file) { throw std::runtime_error{"Could not write replay file " + path.string()}; }
+    }
+};
+
+struct ReplayRecorder {
+    constexpr static std::size_t cBlockSize = 64 * 1024;
+
+    ReplayWriter *writer{};
+    std::vector<uint8_t> buffer;
+
+    void writeVarint(uint64_t value) {
+        while (value >= 0x80U) {
+            buffer.push_back(static_cast<uint8_t>(value | 0x80U));
+            value >>= 7;
+        }
+        buffer.push_back(static_cast<uint8_t>(value));
+    }
+
+    void addGame(const ReplayGame &game) {
+        writeVarint(game.index);
+        writeVarint(static_cast<uint64_t>(game.moves.size()) << 2 | static_cast<uint64_t>(game.finalState));
+        for (std::size_t i = 0; i < game.moves.size(); i += 4) {
+            uint8_t packed = 0;
+            for (std::size_t j = i; j < std::min(i + 4, game.moves.size()); ++j) {
+                packed |= static_cast<uint8_t>((game.moves[j] & 3U) << ((j - i) * 2));
+            }
+            buffer.push_back(packed);
+        }
+        if (buffer.size() >= cBlockSize) { flush(); }
+    }
+
+    void flush() {
+        if (buffer.empty()) { return; }
+        writer->writeBlock(buffer);
+        buffer.clear();
+    }
+};
+
+// A replay file mapped into memory. The records can only be read in sequence, so `gameOffsets`
+// collects the start of each record once, to replay the games in parallel.
+struct ReplayFile {
+    ReplayFileHeader header;
+    std::filesystem::path path;
+    std::shared_ptr<const MappedFile> mappedFile;
+
+    [[nodiscard]] static auto levelHash(const Field &field) noexcept -> uint64_t {
+        uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+        for (const auto &room : field.rooms) {
+            for (const auto value : {room.rect.pos.x, room.rect.pos.y, room.rect.size.width, room.rect.size.height}) {
+                hash = (hash ^ static_cast<uint32_t>(value)) * 0x100000001b3ULL;
+            }
+        }
+        return hash;
+    }
+
+    explicit ReplayFile(const std::filesystem::path &path)
+        : path{path}, mappedFile{std::make_shared<const MappedFile>(path)} {
+        const auto bytes = mappedFile->bytes();
+        if (bytes.size() < sizeof(header)) { fail("The file is too small."); }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        if (header.magic != ReplayFileHeader::cMagic) { fail("Unknown file format."); }
+        if (header.byteOrderMark != ReplayFileHeader::cByteOrderMark) { fail("The file was written with a different byte order."); }
+        if (header.version != ReplayFileHeader::cVersion) { fail("Unsupported version."); }
+        if (header.robotStrategy > static_cast<uint32_t>(RobotStrategy::FlowField)) { fail("Unknown robot strategy."); }
+    }
+
+    [[nodiscard]] auto robotStrategy() const noexcept -> RobotStrategy {
+        return static_cast<RobotStrategy>(header.robotStrategy);
+    }
+
+    /// Start game `gameIndex` exactly like it was started when it was recorded, see `Simulation::playGame`.
+    static void startGame(Logic &logic, uint64_t seed, uint64_t gameIndex, int robotCount) {
+        logic.startGame(Random{seed}.stream(gameIndex).split(), robotCount);
+    }
+
+    /// Replay all moves of `game` and return the state at the end, or nothing if the game ended
+    /// before all moves were used up, which means that it does not match the recording.
+    [[nodiscard]] auto replayGame(Logic &logic, const ReplayGame &game) const -> std::optional<GameState> {
+        startGame(logic, header.seed, game.index, static_cast<int>(header.robotCount));
+        for (const auto move : game.moves) {
+            if (logic.gameState() != GameState::Running) { return std::nullopt; }
+            logic.advance(ReplayGame::inputFromMove(move));
+        }
+        return logic.gameState();
+    }
+
+    [[noreturn]] void fail(const char *reason) const {
+        throw std::runtime_error{std::string{"Invalid replay file "} + path.string() + ": " + reason};
+    }
+
+    [[nodiscard]] auto records() const noexcept -> std::span<const uint8_t> {
+        const auto bytes = mappedFile->bytes();
+        return {reinterpret_cast<const uint8_t*>(bytes.data()) + sizeof(header), bytes.size() - sizeof(header)};
+    }
+
+    [[nodiscard]] auto readVarint(std::size_t &offset) const -> uint64_t {
+        const auto data = records();
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (offset >= data.size()) { fail("The file is truncated."); }
+            const auto byte = data[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7fU) << shift;
+            if ((byte & 0x80U) == 0) { return value; }
+        }
+        fail("Invalid number.");
+    }
+
+    /// Read the record at `offset` into `game` and advance `offset` to the next record.
+    void readGame(std::size_t &offset, ReplayGame &game) const {
+        const auto data = records();
+        game.index = readVarint(offset);
+        const auto turnsAndState = readVarint(offset);
+        if ((turnsAndState & 3U) > static_cast<uint64_t>(GameState::RobotsWon)) { fail("Invalid game state."); }
+        game.finalState = static_cast<GameState>(turnsAndState & 3U);
+        const auto turnCount = turnsAndState >> 2;
+        if ((turnCount + 3) / 4 > data.size() - offset) { fail("The file is truncated."); }
+        game.moves.resize(turnCount);
+        for (std::size_t i = 0; i < turnCount; ++i) {
+            game.moves[i] = (data[offset + i / 4] >> ((i % 4) * 2)) & 3U;
+        }
+        offset += (turnCount + 3) / 4;
+    }
+
+    [[nodiscard]] auto gameOffsets() const -> std::vector<std::size_t> {
+        std::vector<std::size_t> result;
+        ReplayGame game;
+        for (std::size_t offset = 0; offset < records().size();) {
+            result.push_back(offset);
+            readGame(offset, game);
+        }
+        return result;
+    }
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// A fixed-capacity FIFO stored inline. Pushing into a full buffer drops the oldest item,
+// so it never allocates and stays trivially copyable for trivially copyable `T`.
+template<typename T, std::size_t tCapacity>
+struct RingBuffer {
+    std::array<T, tCapacity> items{};
+    std::size_t first{};
+    std::size_t count{};
+
+    struct Iterator {
+        const RingBuffer *buffer{};
+        std::size_t index{};
+
+        auto operator*() const noexcept -> const T& { return (*buffer)[index]; }
+        auto operator++() noexcept -> Iterator& { ++index; return *this; }
+        auto operator==(const Iterator &other) const noexcept -> bool = default;
+    };
+
+    constexpr static auto capacity() noexcept -> std::size_t { return tCapacity; }
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return count; }
+    [[nodiscard]] auto empty() const noexcept -> bool { return count == 0; }
+    void clear() noexcept { first = 0; count = 0; }
+
+    void push(const T &value) noexcept {
+        if constexpr (tCapacity > 0) {
+            if (count < tCapacity) {
+                items[(first + count) % tCapacity] = value;
+                ++count;
+            } else {
+                items[first] = value;
+                first = (first + 1) % tCapacity;
+            }
+        }
+    }
+    /// The item at `index`, counting from the oldest item.
+    [[nodiscard]] auto operator[](std::size_t index) const noexcept -> const T& {
+        return items[(first + index) % tCapacity];
+    }
+    [[nodiscard]] auto begin() const noexcept -> Iterator { return {this, 0}; }
+    [[nodiscard]] auto end() const noexcept -> Iterator { return {this, count}; }
+};
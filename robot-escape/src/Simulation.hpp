@@ -0,0 +1,227 @@
+#pragma once
+
+#include "Bitboard.hpp"
+#include "DistanceField.hpp"
+#include "Heatmap.hpp"
+#include "Logic.hpp"
+#include "Random.hpp"
+#include "Replay.hpp"
+#include "WorkStealingPool.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <ranges>
+#include <vector>
+
+enum class PlayerPolicy {
+    Random,       ///< Move in a random direction every turn.
+    GreedyToExit, ///< Step towards the nearest exit by Manhattan distance, ignoring walls.
+    BfsToExit,    ///< Follow the shortest walkable path to the nearest exit.
+};
+
+struct PlayerController {
+    PlayerPolicy policy{PlayerPolicy::BfsToExit};
+    Random random;
+    DistanceField distanceToExit;
+
+    void startGame(const World &world, Random policyRandom) {
+        random = policyRandom;
+        if (policy != PlayerPolicy::BfsToExit) { return; }
+        // The region around the player and the exits does not contain every path, e.g. in a U-shaped
+        // level. If it cuts the player off, it is doubled, until a path is found, the whole field is
+        // searched, or the cells the player can reach are all inside of it, without an exit.
+        auto region = DistanceField::regionAround(world.player.pos, world.exits | std::views::transform(&Exit::pos));
+        while (true) {
+            distanceToExit.reset(world.field, region);
+            addExitsAndPropagate(world);
+            if (distanceToExit.distanceAt(world.player.pos) != DistanceField::cUnreachable
+                || region.contains(world.field.rect)) {
+                return;
+            }
+            if (!distanceToExit.reachesOutside(world.field, world.player.pos)) { return; }
+            region = region.padded(region.size.width / 2 + 1, region.size.height / 2 + 1);
+        }
+    }
+
+    void addExitsAndPropagate(const World &world) noexcept {
+        for (const auto &exit : world.exits) {
+            distanceToExit.addOrigin(world.field, exit.pos);
+        }
+        distanceToExit.propagate(world.field);
+    }
+
+    [[nodiscard]] auto distanceFrom(Position pos, const World &world) const noexcept -> int {
+        if (policy == PlayerPolicy::BfsToExit) {
+            return distanceToExit.distanceAt(pos);
+        }
+        int bestDistance = std::numeric_limits<int>::max();
+        for (const auto &exit : world.exits) {
+            bestDistance = std::min(bestDistance, pos.distanceTo(exit.pos));
+        }
+        return bestDistance;
+    }
+
+    [[nodiscard]] auto nextInput(const World &world) -> PlayerInput {
+        if (policy == PlayerPolicy::Random) {
+            return PlayerInput{cPosDelta4[random.nextInt(0, static_cast<int>(cPosDelta4.size()) - 1)]};
+        }
+        auto bestInput = PlayerInput{cPosDelta4.front()};
+        int bestDistance = std::numeric_limits<int>::max();
+        for (auto delta : cPosDelta4) {
+            auto pos = world.player.pos + delta;
+            if (!world.isValidPlayerMovement(pos)) continue;
+            auto dist = distanceFrom(pos, world);
+            if (dist < bestDistance) { bestInput = PlayerInput{delta}; bestDistance = dist; }
+        }
+        return bestInput;
+    }
+};
+
+struct SimulationStatistics {
+    std::uint64_t games{};
+    std::uint64_t playerWins{};
+    std::uint64_t robotWins{};
+    std::uint64_t timeouts{};
+    std::uint64_t totalTurns{};
+    int minTurns{std::numeric_limits<int>::max()};
+    int maxTurns{};
+    double seconds{};
+
+    void addGame(GameState state, int turns) noexcept {
+        ++games;
+        switch (state) {
+        case GameState::PlayerWon: ++playerWins; break;
+        case GameState::RobotsWon: ++robotWins; break;
+        case GameState::Running: ++timeouts; break;
+        }
+        totalTurns += turns;
+        minTurns = std::min(minTurns, turns);
+        maxTurns = std::max(maxTurns, turns);
+    }
+    void merge(const SimulationStatistics &other) noexcept {
+        games += other.games;
+        playerWins += other.playerWins;
+        robotWins += other.robotWins;
+        timeouts += other.timeouts;
+        totalTurns += other.totalTurns;
+        minTurns = std::min(minTurns, other.minTurns);
+        maxTurns = std::max(maxTurns, other.maxTurns);
+    }
+    [[nodiscard]] auto percentOfGames(std::uint64_t count) const noexcept -> double {
+        return games == 0 ? 0.0 : 100.0 * static_cast<double>(count) / static_cast<double>(games);
+    }
+    [[nodiscard]] auto averageTurns() const noexcept -> double {
+        return games == 0 ? 0.0 : static_cast<double>(totalTurns) / static_cast<double>(games);
+    }
+    [[nodiscard]] auto gamesPerSecond() const noexcept -> double {
+        return seconds <= 0.0 ? 0.0 : static_cast<double>(games) / seconds;
+    }
+};
+
+enum class SimulationBackend {
+    Automatic, ///< Bit planes if the field is small enough, otherwise the field.
+    Field,     ///< `Logic`, for fields of any size.
+    Bitboard,  ///< `BitboardLogic`, for fields of up to 64x64 cells.
+};
+
+// Plays complete games without any console I/O or rendering. Games are spread over a work-stealing
+// pool; every worker reuses one `Logic` for all its games, so the containers keep their capacity.
+// Game `n` is always seeded with stream `n` of the run seed, and the per-worker statistics are only
+// summed up, so the results do not depend on the thread count.
+// If `replayWriter` is set, the moves of every game are recorded; records are in no particular order.
+// If `heatmap` is set, the positions and captures of all games are added to it, through one
+// `HeatmapShard` per worker.
+struct Simulation {
+    Field field;
+    int robotCount{3};
+    RobotStrategy robotStrategy{RobotStrategy::Greedy};
+    PlayerPolicy playerPolicy{PlayerPolicy::BfsToExit};
+    int maxTurns{1000};
+    ReplayWriter *replayWriter{};
+    Heatmap *heatmap{};
+    SimulationBackend backend{SimulationBackend::Automatic};
+
+    [[nodiscard]] auto usesBitboards() const noexcept -> bool {
+        return backend == SimulationBackend::Bitboard
+            || (backend == SimulationBackend::Automatic && BitboardLogic::fits(field));
+    }
+
+    /// @param replayGame If not null, the moves are recorded into it.
+    /// @param gameHeatmap If not null, the positions of every turn and the capture are counted in it.
+    template<typename tLogic>
+    void playGame(tLogic &logic, PlayerController &controller, Random gameRandom,
+            SimulationStatistics &statistics, ReplayGame *replayGame = nullptr, HeatmapShard *gameHeatmap = nullptr) const {
+        logic.startGame(gameRandom.split(), robotCount);
+        controller.startGame(logic.world, gameRandom.split());
+        if (gameHeatmap != nullptr) { gameHeatmap->addTurn(logic.world); }
+        int turns = 0;
+        auto state = logic.gameState();
+        while (state == GameState::Running && turns < maxTurns) {
+            const auto input = controller.nextInput(logic.world);
+            if (replayGame != nullptr) { replayGame->moves.push_back(ReplayGame::moveFromInput(input)); }
+            logic.advance(input);
+            if (gameHeatmap != nullptr) { gameHeatmap->addTurn(logic.world); }
+            ++turns;
+            state = logic.gameState();
+        }
+        statistics.addGame(state, turns);
+        if (gameHeatmap != nullptr) { gameHeatmap->addGameEnd(logic.world, state); }
+        if (replayGame != nullptr) { replayGame->finalState = state; }
+    }
+
+    [[nodiscard]] auto run(std::uint64_t games, std::uint64_t seed, unsigned threadCount) const -> SimulationStatistics {
+        if (usesBitboards()) { return runGames<BitboardLogic>(games, seed, threadCount); }
+        return runGames<Logic>(games, seed, threadCount);
+    }
+
+    template<typename tLogic>
+    [[nodiscard]] auto runGames(std::uint64_t games, std::uint64_t seed, unsigned threadCount) const -> SimulationStatistics {
+        const auto startTime = std::chrono::steady_clock::now();
+        const auto runRandom = Random{seed};
+        auto pool = WorkStealingPool{threadCount};
+        auto shards = std::vector<SimulationStatistics>(pool.threadCount);
+        if (heatmap != nullptr && heatmap->empty()) { *heatmap = Heatmap{field}; }
+        std::mutex heatmapMutex;
+        auto addToHeatmap = [&](HeatmapShard &heatmapShard) {
+            const auto lock = std::scoped_lock{heatmapMutex};
+            heatmap->add(heatmapShard);
+            heatmapShard.clear();
+        };
+        pool.run(games, [&](WorkStealingPool::Worker &worker) {
+            auto logic = tLogic{World{field}, robotStrategy};
+            auto controller = PlayerController{playerPolicy};
+            auto statistics = SimulationStatistics{};
+            auto recorder = ReplayRecorder{replayWriter};
+            auto replayGame = ReplayGame{};
+            auto heatmapShard = heatmap != nullptr ? HeatmapShard{field} : HeatmapShard{};
+            auto *workerHeatmap = heatmap != nullptr ? &heatmapShard : nullptr;
+            std::uint64_t game{};
+            while (worker.next(game)) {
+                // A game counts at most `maxTurns + 1` turns.
+                if (workerHeatmap != nullptr && !workerHeatmap->canCount(static_cast<std::uint64_t>(maxTurns) + 1)) {
+                    addToHeatmap(*workerHeatmap);
+                }
+                if (replayWriter == nullptr) {
+                    playGame(logic, controller, runRandom.stream(game), statistics, nullptr, workerHeatmap);
+                    continue;
+                }
+                replayGame.clear(game);
+                playGame(logic, controller, runRandom.stream(game), statistics, &replayGame, workerHeatmap);
+                recorder.addGame(replayGame);
+            }
+            if (replayWriter != nullptr) { recorder.flush(); }
+            if (workerHeatmap != nullptr) { addToHeatmap(*workerHeatmap); }
+            shards[worker.index] = statistics;
+        });
+        SimulationStatistics result;
+        for (const auto &shard : shards) {
+            result.merge(shard);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        return result;
+    }
+};
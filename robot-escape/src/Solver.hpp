@@ -0,0 +1,387 @@
+#pragma once
+
+#include "DistanceField.hpp"
+#include "Logic.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// A game state, packed into 128 bits: the cell index of the player, followed by the cell index
+// of every robot, each with the same number of bits.
+struct SolverKey {
+    uint64_t low{};
+    uint64_t high{};
+
+    auto operator==(const SolverKey &other) const noexcept -> bool = default;
+
+    void append(uint64_t value, int bitCount, int &offset) noexcept {
+        if (offset < 64) {
+            low |= value << offset;
+            if (offset + bitCount > 64) { high |= value >> (64 - offset); }
+        } else {
+            high |= value << (offset - 64);
+        }
+        offset += bitCount;
+    }
+    [[nodiscard]] auto hash() const noexcept -> uint64_t {
+        auto value = low ^ (high * 0x9e3779b97f4a7c15ULL);
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        return value ^ (value >> 31);
+    }
+};
+
+// What is known about each visited state, in an open-addressing hash table.
+struct SolverTable {
+    constexpr static std::size_t cMinimumCapacity = std::size_t{1} << 16;
+    constexpr static std::size_t cMaximumCapacity = std::size_t{1} << 23; // 24 bytes each, 192 MiB
+    constexpr static uint16_t cUnknownWin = 0xffff;
+
+    struct Entry {
+        SolverKey key;
+        uint16_t winTurns{cUnknownWin}; // the player can force a win within this many turns.
+        uint16_t lossTurns{}; // the player cannot force a win within this many turns.
+        bool isUsed{false};
+    };
+
+    std::vector<Entry> entries;
+    std::size_t size{};
+
+    [[nodiscard]] auto find(const SolverKey &key) const noexcept -> const Entry* {
+        if (entries.empty()) { return nullptr; }
+        const auto mask = entries.size() - 1;
+        for (auto index = key.hash() & mask; entries[index].isUsed; index = (index + 1) & mask) {
+            if (entries[index].key == key) { return &entries[index]; }
+        }
+        return nullptr;
+    }
+
+    /// Find or add the entry for `key`. When the table is at its maximum size, new states are not
+    /// stored anymore and `nullptr` is returned; this only costs time, the result stays exact.
+    auto insert(const SolverKey &key) -> Entry* {
+        if ((size + 1) * 2 > entries.size()) {
+            if (entries.size() >= cMaximumCapacity) {
+                return const_cast<Entry*>(find(key));
+            }
+            grow();
+        }
+        const auto mask = entries.size() - 1;
+        auto index = key.hash() & mask;
+        for (; entries[index].isUsed; index = (index + 1) & mask) {
+            if (entries[index].key == key) { return &entries[index]; }
+        }
+        ++size;
+        entries[index] = Entry{.key = key, .isUsed = true};
+        return &entries[index];
+    }
+
+    void grow() {
+        auto oldEntries = std::move(entries);
+        entries.assign(std::max(cMinimumCapacity, oldEntries.size() * 2), Entry{});
+        const auto mask = entries.size() - 1;
+        for (const auto &entry : oldEntries) {
+            if (!entry.isUsed) { continue; }
+            auto index = entry.key.hash() & mask;
+            while (entries[index].isUsed) { index = (index + 1) & mask; }
+            entries[index] = entry;
+        }
+    }
+
+    [[nodiscard]] auto memorySize() const noexcept -> std::size_t { return entries.size() * sizeof(Entry); }
+};
+
+struct SolverResult {
+    bool canWin{false};
+    int turns{}; // the number of turns in which the player can force a win.
+    std::vector<PlayerInput> inputs; // a shortest winning line against the tie-breaks of the game.
+    uint64_t visitedStates{};
+    std::size_t storedStates{};
+    std::size_t memorySize{};
+    double seconds{};
+};
+
+// Decides if the player can force a win, whatever the robots choose when they have more than one
+// best move. The search is a depth-limited AND-OR search: the player needs one move after which
+// all robot choices lead to a win. The walking distance to the nearest exit is a lower bound
+// that cuts off most of the moves. Robots that cannot reach the player or any robot that matters
+// within the remaining turns cannot change the result; they are left out of the state and frozen,
+// which keeps the search local on large fields.
+struct Solver {
+    constexpr static int cDefaultMaxTurns = 100;
+    constexpr static int cMaximumMaxTurns = 10000;
+    constexpr static int cFlowFieldCacheTile = 32; // the cache holds the flow fields of a tile of player positions.
+
+    struct CachedRobotLogic {
+        Position playerPos;
+        bool isValid{false};
+        RobotLogic robotLogic;
+    };
+
+    World world; // the state that is searched, changed and restored during the search.
+    RobotStrategy strategy;
+    int maxTurns;
+    int bitsPerCell{};
+    DistanceField distanceToExit;
+    std::vector<int> exitReach; // per cell of `distanceToExit`: the minimum of the Manhattan distance to a cell plus its exit distance.
+    RobotLogic greedyRobotLogic;
+    std::vector<CachedRobotLogic> flowFieldCache; // the flow field for recent player positions, allocated on first use.
+    SolverTable table;
+    uint64_t visitedStates{};
+
+    Solver(const World &initialWorld, RobotStrategy strategy, int maxTurns)
+        : world{initialWorld}, strategy{strategy}, maxTurns{std::clamp(maxTurns, 1, cMaximumMaxTurns)} {
+        bitsPerCell = std::bit_width(static_cast<uint64_t>(world.field.rect.size.area()));
+        if (static_cast<int>(world.robots.size() + 1) * bitsPerCell > 128) {
+            throw std::logic_error{"There are too many robots on this field to solve the game."};
+        }
+        // Within `maxTurns`, the player cannot leave this region, and neither can any path to an exit
+        // that is short enough to matter. So distances in the region are exact where they are needed.
+        const auto region = Rectangle{world.player.pos, Size{1, 1}}.padded(this->maxTurns, this->maxTurns);
+        distanceToExit.reset(world.field, region);
+        for (const auto &exit : world.exits) {
+            distanceToExit.addOrigin(world.field, exit.pos);
+        }
+        distanceToExit.propagate(world.field);
+        updateExitReach();
+        if (strategy == RobotStrategy::FlowField) {
+            flowFieldCache.resize(cFlowFieldCacheTile * cFlowFieldCacheTile, CachedRobotLogic{.robotLogic = RobotLogic{strategy}});
+        }
+    }
+
+    // A two pass distance transform: walls do not matter, as a lower bound for the moves of the robots.
+    void updateExitReach() {
+        const auto width = distanceToExit.rect.size.width;
+        const auto height = distanceToExit.rect.size.height;
+        exitReach.resize(distanceToExit.distances.size());
+        std::ranges::transform(distanceToExit.distances, exitReach.begin(), [](int distance) {
+            return std::min(distance, DistanceField::cUnreachable / 2);
+        });
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                auto &reach = exitReach[y * width + x];
+                if (x > 0) { reach = std::min(reach, exitReach[y * width + x - 1] + 1); }
+                if (y > 0) { reach = std::min(reach, exitReach[(y - 1) * width + x] + 1); }
+            }
+        }
+        for (int y = height - 1; y >= 0; --y) {
+            for (int x = width - 1; x >= 0; --x) {
+                auto &reach = exitReach[y * width + x];
+                if (x + 1 < width) { reach = std::min(reach, exitReach[y * width + x + 1] + 1); }
+                if (y + 1 < height) { reach = std::min(reach, exitReach[(y + 1) * width + x] + 1); }
+            }
+        }
+    }
+
+    /// A lower bound for the turns a robot at `pos` needs to meet the player on any cell, plus the
+    /// turns the player needs from that cell to an exit.
+    [[nodiscard]] auto exitReachAt(Position pos) const noexcept -> int {
+        const auto &rect = distanceToExit.rect;
+        const auto inside = Position{
+            std::clamp(pos.x, rect.pos.x, rect.pos.x + rect.size.width - 1),
+            std::clamp(pos.y, rect.pos.y, rect.pos.y + rect.size.height - 1)};
+        return exitReach[rect.size.index(inside - rect.pos)] + pos.distanceTo(inside);
+    }
+
+    [[nodiscard]] auto cellOf(Position pos) const noexcept -> uint64_t {
+        return static_cast<uint64_t>(world.field.rect.size.index(pos - world.field.rect.pos));
+    }
+
+    [[nodiscard]] auto isExit(Position pos) const noexcept -> bool {
+        return std::ranges::any_of(world.exits, [&](const Exit &exit) { return exit.pos == pos; });
+    }
+
+    /// The robot logic, prepared for the current position of the player.
+    [[nodiscard]] auto robotLogic() -> const RobotLogic& {
+        if (strategy != RobotStrategy::FlowField) { return greedyRobotLogic; }
+        constexpr auto cMask = cFlowFieldCacheTile - 1;
+        const auto slot = static_cast<std::size_t>((world.player.pos.y & cMask) * cFlowFieldCacheTile + (world.player.pos.x & cMask));
+        auto &cached = flowFieldCache[slot];
+        if (!cached.isValid || cached.playerPos != world.player.pos) {
+            cached.robotLogic.prepareTurn(world);
+            cached.playerPos = world.player.pos;
+            cached.isValid = true;
+        }
+        return cached.robotLogic;
+    }
+
+    // Each turn, the player and every robot move at most one cell. So a robot can only catch the
+    // player within `turns` if it is at most `2 * turns` away, and it can only block another robot
+    // if it comes next to it. A catch only matters on a cell from which the player could still
+    // reach an exit in time, which rules out the robots that follow the player from behind; each
+    // robot in a chain of blocking robots adds a turn to this bound. Robots that cannot matter
+    // are frozen, bit `i` is set for robot `i`.
+    [[nodiscard]] auto frozenRobots(int turns, uint64_t frozen) const noexcept -> uint64_t {
+        const auto robotCount = world.robots.size();
+        const auto reachLimit = turns + static_cast<int>(robotCount) + 2;
+        for (std::size_t i = 0; i < robotCount; ++i) {
+            if (exitReachAt(world.robots[i].pos) > reachLimit) { frozen |= uint64_t{1} << i; }
+        }
+        uint64_t relevant = 0;
+        for (std::size_t i = 0; i < robotCount; ++i) {
+            if ((frozen >> i & 1U) == 0 && world.robots[i].pos.distanceTo(world.player.pos) <= 2 * turns) {
+                relevant |= uint64_t{1} << i;
+            }
+        }
+        for (bool hasChanged = true; hasChanged;) {
+            hasChanged = false;
+            for (std::size_t i = 0; i < robotCount; ++i) {
+                if ((frozen >> i & 1U) != 0 || (relevant >> i & 1U) != 0) { continue; }
+                for (std::size_t j = 0; j < robotCount; ++j) {
+                    if ((relevant >> j & 1U) != 0 && world.robots[i].pos.distanceTo(world.robots[j].pos) <= 2 * turns + 2) {
+                        relevant |= uint64_t{1} << i;
+                        hasChanged = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return ((uint64_t{1} << robotCount) - 1) & ~relevant;
+    }
+
+    [[nodiscard]] auto keyFor(uint64_t frozen) const noexcept -> SolverKey {
+        const auto frozenCell = (uint64_t{1} << bitsPerCell) - 1;
+        SolverKey key;
+        int offset = 0;
+        key.append(cellOf(world.player.pos), bitsPerCell, offset);
+        for (std::size_t i = 0; i < world.robots.size(); ++i) {
+            key.append((frozen >> i & 1U) != 0 ? frozenCell : cellOf(world.robots[i].pos), bitsPerCell, offset);
+        }
+        return key;
+    }
+
+    /// The distinct positions the player can reach in one turn; an invalid move keeps the position.
+    [[nodiscard]] auto playerTargets(std::array<Position, cPosDelta4.size() + 1> &targets) const noexcept -> int {
+        int count = 0;
+        bool canStay = false;
+        for (const auto delta : cPosDelta4) {
+            const auto pos = world.player.pos + delta;
+            if (world.isValidPlayerMovement(pos)) {
+                targets[count++] = pos;
+            } else {
+                canStay = true;
+            }
+        }
+        if (canStay) { targets[count++] = world.player.pos; }
+        // Moves towards an exit first, so wins are found early.
+        for (int i = 1; i < count; ++i) {
+            for (int j = i; j > 0 && distanceToExit.distanceAt(targets[j]) < distanceToExit.distanceAt(targets[j - 1]); --j) {
+                std::swap(targets[j], targets[j - 1]);
+            }
+        }
+        return count;
+    }
+
+    /// Test if the player wins after moving to `target`, for all robot moves that follow.
+    [[nodiscard]] auto winsAfterMove(Position target, int turns, uint64_t frozen) -> bool {
+        if (isExit(target)) { return true; }
+        if (world.robotIndex.anyWithin(target, 0) || distanceToExit.distanceAt(target) > turns - 1) { return false; }
+        const auto playerPos = world.player.pos;
+        world.player.pos = target;
+        const auto wins = allRobotMovesWin(0, turns, frozen);
+        world.player.pos = playerPos;
+        return wins;
+    }
+
+    // Robots move one after the other and block each other, so each robot chooses after the
+    // previous ones have moved.
+    [[nodiscard]] auto allRobotMovesWin(std::size_t robotIndex, int turns, uint64_t frozen) -> bool {
+        if (robotIndex == world.robots.size()) { return canWin(turns - 1, frozen); }
+        if ((frozen >> robotIndex & 1U) != 0) { return allRobotMovesWin(robotIndex + 1, turns, frozen); }
+        std::array<Position, cPosDelta4.size()> moves;
+        const auto moveCount = robotLogic().bestMoves(world.robots[robotIndex], world, moves);
+        if (moveCount == 0) { return allRobotMovesWin(robotIndex + 1, turns, frozen); }
+        const auto robotPos = world.robots[robotIndex].pos;
+        for (int i = 0; i < moveCount; ++i) {
+            world.moveRobot(robotIndex, moves[i]);
+            const auto wins = moves[i] != world.player.pos && allRobotMovesWin(robotIndex + 1, turns, frozen);
+            world.moveRobot(robotIndex, robotPos);
+            if (!wins) { return false; }
+        }
+        return true;
+    }
+
+    /// Test if the player can force a win within `turns` from the current state.
+    [[nodiscard]] auto canWin(int turns, uint64_t frozen) -> bool {
+        if (turns <= 0 || distanceToExit.distanceAt(world.player.pos) > turns) { return false; }
+        ++visitedStates;
+        frozen = frozenRobots(turns, frozen);
+        const auto key = keyFor(frozen);
+        if (const auto *entry = table.find(key); entry != nullptr) {
+            if (entry->winTurns <= turns) { return true; }
+            if (entry->lossTurns >= turns) { return false; }
+        }
+        std::array<Position, cPosDelta4.size() + 1> targets;
+        const auto targetCount = playerTargets(targets);
+        bool wins = false;
+        for (int i = 0; i < targetCount && !wins; ++i) {
+            wins = winsAfterMove(targets[i], turns, frozen);
+        }
+        if (auto *entry = table.insert(key); entry != nullptr) {
+            if (wins) {
+                entry->winTurns = std::min(entry->winTurns, static_cast<uint16_t>(turns));
+            } else {
+                entry->lossTurns = std::max(entry->lossTurns, static_cast<uint16_t>(turns));
+            }
+        }
+        return wins;
+    }
+
+    /// Copy the positions of the elements from `other`, a later state of the same game.
+    void setState(const World &other) {
+        world.player.pos = other.player.pos;
+        for (std::size_t i = 0; i < world.robots.size(); ++i) {
+            world.moveRobot(i, other.robots[i].pos);
+        }
+    }
+
+    /// Solve the game in `logic`, and play the winning line with the tie-breaks of its random generator.
+    [[nodiscard]] auto solve(Logic logic) -> SolverResult {
+        const auto startTime = std::chrono::steady_clock::now();
+        SolverResult result;
+        // One search with all turns proves most losses. Only if the player can win, a binary search
+        // finds the shortest win; the wins that were found before are reused from the table.
+        const auto startDistance = distanceToExit.distanceAt(world.player.pos);
+        if (startDistance <= maxTurns && canWin(maxTurns, 0)) {
+            result.canWin = true;
+            auto minimumTurns = std::max(startDistance, 1);
+            result.turns = maxTurns;
+            while (minimumTurns < result.turns) {
+                const auto turns = minimumTurns + (result.turns - minimumTurns) / 2;
+                if (canWin(turns, 0)) {
+                    result.turns = turns;
+                } else {
+                    minimumTurns = turns + 1;
+                }
+            }
+        }
+        if (result.canWin) {
+            for (int turns = result.turns; logic.gameState() == GameState::Running; --turns) {
+                setState(logic.world);
+                const auto frozen = frozenRobots(turns, 0);
+                const auto input = std::ranges::find_if(cPosDelta4, [&](Position delta) {
+                    const auto target = world.isValidPlayerMovement(world.player.pos + delta)
+                        ? world.player.pos + delta : world.player.pos;
+                    return winsAfterMove(target, turns, frozen);
+                });
+                if (input == cPosDelta4.end()) { throw std::logic_error{"The solver found no winning move."}; }
+                result.inputs.push_back(PlayerInput{*input});
+                logic.advance(PlayerInput{*input});
+            }
+        }
+        result.visitedStates = visitedStates;
+        result.storedStates = table.size;
+        result.memorySize = table.memorySize() + (distanceToExit.distances.size() + distanceToExit.queue.size()) * sizeof(int);
+        for (const auto &cached : flowFieldCache) {
+            const auto &distanceField = cached.robotLogic.distanceToPlayer;
+            result.memorySize += (distanceField.distances.size() + distanceField.queue.size()) * sizeof(int);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        return result;
+    }
+};
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Geometry.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// Finds elements near a position in near-constant time. Elements are grouped into square buckets,
+// each bucket is a linked list through `nextElement`. Only occupied buckets are stored, in an
+// open-addressing hash table, so the memory use depends on the number of elements, not on the
+// size of the field.
+struct SpatialIndex {
+    constexpr static int cBucketShift = 3; // buckets of 8x8 cells
+    constexpr static uint32_t cNoElement = 0xffffffffU;
+    constexpr static std::size_t cMinimumCapacity = 16;
+
+    struct Bucket {
+        Position key;
+        uint32_t firstElement{cNoElement};
+        bool isUsed{false};
+    };
+
+    std::vector<Bucket> buckets; // the hash table, its size is a power of two.
+    std::size_t usedBucketCount{};
+    std::vector<Position> positions; // for each element
+    std::vector<uint32_t> nextElement; // for each element
+
+    [[nodiscard]] static auto bucketKey(Position pos) noexcept -> Position {
+        return {pos.x >> cBucketShift, pos.y >> cBucketShift};
+    }
+    [[nodiscard]] static auto hash(Position key) noexcept -> std::size_t {
+        return (static_cast<uint32_t>(key.x) * 0x9e3779b1U) ^ (static_cast<uint32_t>(key.y) * 0x85ebca77U);
+    }
+
+    void clear() noexcept {
+        std::ranges::fill(buckets, Bucket{});
+        usedBucketCount = 0;
+        positions.clear();
+        nextElement.clear();
+    }
+
+    /// The index of the bucket for `key`, or the size of the table if there is none.
+    [[nodiscard]] auto findBucket(Position key) const noexcept -> std::size_t {
+        if (buckets.empty()) { return 0; }
+        const auto mask = buckets.size() - 1;
+        for (auto index = hash(key) & mask; buckets[index].isUsed; index = (index + 1) & mask) {
+            if (buckets[index].key == key) { return index; }
+        }
+        return buckets.size();
+    }
+
+    // Buckets stay in the table when they become empty. Instead, the table is rebuilt from
+    // the elements when it gets too full. This must happen before an element is changed,
+    // as the rebuild links all elements.
+    void reserveBucket() {
+        if ((usedBucketCount + 1) * 2 > buckets.size()) { rebuild(); }
+    }
+
+    auto bucketFor(Position key) noexcept -> Bucket& {
+        const auto mask = buckets.size() - 1;
+        auto index = hash(key) & mask;
+        for (; buckets[index].isUsed; index = (index + 1) & mask) {
+            if (buckets[index].key == key) { return buckets[index]; }
+        }
+        ++usedBucketCount;
+        buckets[index] = Bucket{key, cNoElement, true};
+        return buckets[index];
+    }
+
+    void rebuild() {
+        const auto capacity = std::bit_ceil(std::max(cMinimumCapacity, (positions.size() + 1) * 4));
+        buckets.assign(capacity, Bucket{});
+        usedBucketCount = 0;
+        for (uint32_t element = 0; element < positions.size(); ++element) {
+            link(element);
+        }
+    }
+
+    void link(uint32_t element) noexcept {
+        auto &bucket = bucketFor(bucketKey(positions[element]));
+        nextElement[element] = bucket.firstElement;
+        bucket.firstElement = element;
+    }
+
+    void unlink(uint32_t element) noexcept {
+        auto *link = &buckets[findBucket(bucketKey(positions[element]))].firstElement;
+        while (*link != element) { link = &nextElement[*link]; }
+        *link = nextElement[element];
+    }
+
+    /// Add the element with the next index, which is the current number of elements.
+    void add(Position pos) {
+        reserveBucket();
+        positions.push_back(pos);
+        nextElement.push_back(cNoElement);
+        link(static_cast<uint32_t>(positions.size() - 1));
+    }
+
+    void move(uint32_t element, Position newPos) {
+        if (bucketKey(positions[element]) == bucketKey(newPos)) {
+            positions[element] = newPos;
+            return;
+        }
+        reserveBucket();
+        unlink(element);
+        positions[element] = newPos;
+        link(element);
+    }
+
+    /// Test if any element is within the Manhattan `distance` of `pos`.
+    [[nodiscard]] auto anyWithin(Position pos, int distance) const noexcept -> bool {
+        const auto first = bucketKey(pos - Position{distance, distance});
+        const auto last = bucketKey(pos + Position{distance, distance});
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                const auto bucketIndex = findBucket({x, y});
+                if (bucketIndex == buckets.size()) { continue; }
+                for (auto element = buckets[bucketIndex].firstElement; element != cNoElement; element = nextElement[element]) {
+                    if (positions[element].distanceTo(pos) <= distance) { return true; }
+                }
+            }
+        }
+        return false;
+    }
+};
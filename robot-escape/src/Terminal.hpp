@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Logic.hpp"
+
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+// Switches the console into raw mode while it exists: the keys are read one by one, without echo
+// and line editing, and without waiting for them. Ctrl+C is read as a key as well, so the mode is
+// always restored.
+struct RawTerminal {
+    termios savedMode{};
+    std::array<char, 256> buffer{};
+
+    RawTerminal() {
+        if (::isatty(STDIN_FILENO) == 0 || ::tcgetattr(STDIN_FILENO, &savedMode) != 0) {
+            throw std::runtime_error{"The real-time mode needs a terminal."};
+        }
+        auto mode = savedMode;
+        mode.c_lflag &= ~static_cast<tcflag_t>(ICANON | ECHO | ISIG);
+        mode.c_cc[VMIN] = 0;
+        mode.c_cc[VTIME] = 0;
+        if (::tcsetattr(STDIN_FILENO, TCSANOW, &mode) != 0) {
+            throw std::runtime_error{"Could not switch the terminal into raw mode."};
+        }
+    }
+    ~RawTerminal() {
+        ::tcsetattr(STDIN_FILENO, TCSANOW, &savedMode);
+    }
+    RawTerminal(const RawTerminal&) = delete;
+    auto operator=(const RawTerminal&) -> RawTerminal& = delete;
+
+    /// Wait until a key is pressed, or until `deadline`.
+    /// @return The bytes that were read, empty at the deadline. Valid until the next call.
+    [[nodiscard]] auto read(std::chrono::steady_clock::time_point deadline) noexcept -> std::string_view {
+        const auto timeout = std::max(deadline - std::chrono::steady_clock::now(), std::chrono::steady_clock::duration{});
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        const auto waitTime = timespec{
+            .tv_sec = static_cast<time_t>(seconds.count()),
+            .tv_nsec = static_cast<long>(std::chrono::nanoseconds{timeout - seconds}.count()),
+        };
+        auto input = pollfd{.fd = STDIN_FILENO, .events = POLLIN, .revents = 0};
+        if (::ppoll(&input, 1, &waitTime, nullptr) <= 0) { return {}; }
+        const auto count = ::read(STDIN_FILENO, buffer.data(), buffer.size());
+        if (count <= 0) { return {}; }
+        return std::string_view{buffer.data(), static_cast<std::size_t>(count)};
+    }
+};
+
+// Turns the bytes from a raw terminal into inputs: the keys of `inputFromKey`, and the escape
+// sequences of the arrow keys. A sequence may be split between two reads.
+struct KeyDecoder {
+    enum class State : uint8_t {
+        Key,
+        Escape,   // after ESC.
+        Sequence, // after ESC and `[` or `O`, until the final byte.
+    };
+
+    State state{State::Key};
+
+    /// @return The input for this byte, or an empty input if the byte completes no key.
+    [[nodiscard]] auto feed(char byte) noexcept -> PlayerInput {
+        constexpr char cEscape = '\x1b';
+        constexpr char cInterrupt = '\x03'; // Ctrl+C
+        switch (state) {
+        case State::Key:
+            break;
+        case State::Escape:
+            if (byte == '[' || byte == 'O') {
+                state = State::Sequence;
+                return {};
+            }
+            state = State::Key;
+            break;
+        case State::Sequence:
+            if (byte < '@' || byte > '~') { return {}; } // a parameter of the sequence.
+            state = State::Key;
+            switch (byte) {
+            case 'A': return inputFromKey('n');
+            case 'B': return inputFromKey('s');
+            case 'C': return inputFromKey('e');
+            case 'D': return inputFromKey('w');
+            default: return {};
+            }
+        }
+        if (byte == cEscape) {
+            state = State::Escape;
+            return {};
+        }
+        if (byte == cInterrupt) { return cQuitInput; }
+        return inputFromKey(byte);
+    }
+};
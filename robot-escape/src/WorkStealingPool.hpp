@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs the indices `[0, count)` on a fixed number of threads. Every worker starts with an equal
+// slice and processes it in small chunks. A worker that runs out of work steals the back half of
+// the remaining slice from another worker, so uneven game lengths do not leave cores idle.
+struct WorkStealingPool {
+    struct alignas(64) Slice {
+        std::mutex mutex;
+        std::uint64_t begin{};
+        std::uint64_t end{};
+    };
+
+    struct Worker {
+        WorkStealingPool &pool;
+        unsigned index{};
+        std::uint64_t chunkBegin{};
+        std::uint64_t chunkEnd{};
+
+        /// Get the next index to process, or `false` if all the work is done.
+        auto next(std::uint64_t &item) -> bool {
+            if (chunkBegin == chunkEnd && !pool.takeChunk(index, chunkBegin, chunkEnd)) { return false; }
+            item = chunkBegin++;
+            return true;
+        }
+    };
+
+    unsigned threadCount{1};
+    std::uint64_t chunkSize{64};
+    std::unique_ptr<Slice[]> slices;
+
+    explicit WorkStealingPool(unsigned threadCount, std::uint64_t chunkSize = 64)
+        : threadCount{std::max(threadCount, 1U)}, chunkSize{std::max<std::uint64_t>(chunkSize, 1)} {}
+
+    [[nodiscard]] static auto defaultThreadCount() noexcept -> unsigned {
+        return std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    auto popChunk(Slice &slice, std::uint64_t &chunkBegin, std::uint64_t &chunkEnd) -> bool {
+        std::lock_guard lock{slice.mutex};
+        if (slice.begin == slice.end) { return false; }
+        chunkBegin = slice.begin;
+        chunkEnd = std::min(slice.end, slice.begin + chunkSize);
+        slice.begin = chunkEnd;
+        return true;
+    }
+
+    auto stealHalf(Slice &victim, std::uint64_t &stolenBegin, std::uint64_t &stolenEnd) -> bool {
+        std::lock_guard lock{victim.mutex};
+        if (victim.begin == victim.end) { return false; }
+        const auto middle = victim.begin + (victim.end - victim.begin) / 2;
+        stolenBegin = middle;
+        stolenEnd = victim.end;
+        victim.end = middle;
+        return true;
+    }
+
+    auto takeChunk(unsigned workerIndex, std::uint64_t &chunkBegin, std::uint64_t &chunkEnd) -> bool {
+        auto &ownSlice = slices[workerIndex];
+        if (popChunk(ownSlice, chunkBegin, chunkEnd)) { return true; }
+        for (unsigned offset = 1; offset < threadCount; ++offset) {
+            std::uint64_t stolenBegin{};
+            std::uint64_t stolenEnd{};
+            if (!stealHalf(slices[(workerIndex + offset) % threadCount], stolenBegin, stolenEnd)) { continue; }
+            {
+                std::lock_guard lock{ownSlice.mutex};
+                ownSlice.begin = stolenBegin;
+                ownSlice.end = stolenEnd;
+            }
+            return popChunk(ownSlice, chunkBegin, chunkEnd);
+        }
+        return false;
+    }
+
+    /// Call `fn(worker)` once on every thread; it pulls indices with `worker.next(index)`.
+    template<typename Fn>
+    void run(std::uint64_t count, Fn fn) {
+        slices = std::make_unique<Slice[]>(threadCount);
+        for (unsigned i = 0; i < threadCount; ++i) {
+            slices[i].begin = count / threadCount * i + std::min<std::uint64_t>(i, count % threadCount);
+            slices[i].end = slices[i].begin + count / threadCount + (i < count % threadCount ? 1 : 0);
+        }
+        std::vector<std::jthread> threads;
+        threads.reserve(threadCount - 1);
+        for (unsigned i = 1; i < threadCount; ++i) {
+            threads.emplace_back([this, i, &fn] {
+                auto worker = Worker{*this, i};
+                fn(worker);
+            });
+        }
+        auto worker = Worker{*this, 0};
+        fn(worker);
+    }
+};
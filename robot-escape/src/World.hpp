@@ -2,19 +2,27 @@
 
 #include "Geometry.hpp"
 #include "Canvas.hpp"
+#include "Field.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "RingBuffer.hpp"
+#include "SpatialIndex.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <type_traits>
 #include <vector>
 
-template<Block tElementBlock, Block tTrailBlock = tElementBlock>
+template<Block tElementBlock, Block tTrailBlock = tElementBlock, std::size_t tTrailLength = 0>
 struct ElementWithPos {
     Position pos{};
-    std::vector<Position> trail;
-    std::string name;
+    RingBuffer<Position, tTrailLength> trail;
 
     void moveTo(Position newPos) noexcept {
-        trail.push_back(pos);
-        if (trail.size() > 3) { trail.erase(trail.begin()); }
+        trail.push(pos);
         pos = newPos;
     }
 
@@ -27,52 +35,31 @@ struct ElementWithPos {
     }
 };
 
-using Player = ElementWithPos<Block::Player, Block::PlayerTrail>;
-using Robot = ElementWithPos<Block::Robot, Block::RobotTrail>;
-using Exit = ElementWithPos<Block::Exit>;
+constexpr static std::size_t cPlayerTrailLength = 3;
+constexpr static std::size_t cRobotTrailLength = 3;
 
-struct Room {
-    Rectangle rect;
-};
+using Player = ElementWithPos<Block::Player, Block::PlayerTrail, cPlayerTrailLength>;
+using Robot = ElementWithPos<Block::Robot, Block::RobotTrail, cRobotTrailLength>;
+using Exit = ElementWithPos<Block::Exit>;
 
-struct Field {
-    std::vector<Room> rooms;
-    Rectangle rect;
-
-    void updatePosAndSize() {
-        rect = rooms.front().rect;
-        for (std::size_t i = 1; i < rooms.size(); ++i) {
-            rect |= rooms[i].rect;
-        }
-    }
-    void addRoom(Rectangle roomRect) {
-        rooms.emplace_back(Room{roomRect});
-        updatePosAndSize();
-    }
-    void render(Canvas &canvas) const noexcept {
-        for (const auto &room : rooms) { canvas.fillRect(room.rect.padded(1, 1), Block::Wall); }
-        for (const auto &room : rooms) { canvas.fillRect(room.rect, Block::Room); }
-    }
-    [[nodiscard]] auto contains(Position pos) const noexcept -> bool {
-        return std::ranges::any_of(rooms, [&](const auto &room) -> bool { return room.rect.contains(pos); });
-    }
-    template<typename Fn> auto filterPositions(Fn fn) const -> std::vector<Position> {
-        std::vector<Position> result;
-        result.reserve(rect.size.area());
-        rect.forEach([&](const Position& pos) {
-            if (contains(pos) && fn(pos)) { result.push_back(pos); }
-        });
-        return result;
-    }
-};
+// The elements are copied as flat memory into game snapshots.
+static_assert(std::is_trivially_copyable_v<Player> && std::is_trivially_copyable_v<Robot> && std::is_trivially_copyable_v<Exit>);
 
 struct World {
+    constexpr static int cPlayerExitDistance = 3; // the player starts further away from any exit.
+    constexpr static int cRobotPlayerDistance = 4; // robots start further away from the player...
+    constexpr static int cRobotExitDistance = 4; // ...and from any exit...
+    constexpr static int cRobotRobotDistance = 1; // ...and from each other.
+
     Field field;
     Player player;
     std::vector<Robot> robots;
+    SpatialIndex robotIndex; // the positions of `robots`, use `moveRobot` to keep it up to date.
     std::vector<Exit> exits;
+    Random random;
 
     World() = default;
+    explicit World(Field field) : field{std::move(field)} {}
     template<typename T>
     [[nodiscard]] static auto tooNear(Position pos, int distance, const std::vector<T> &elements) {
         return std::any_of(elements.begin(), elements.end(), [&](const auto &element) {
@@ -83,21 +70,41 @@ struct World {
         return field.contains(pos);
     }
     [[nodiscard]] auto isValidRobotMovement(Position pos) const noexcept -> bool {
-        return field.contains(pos) && !tooNear(pos, 0, robots);
+        return field.contains(pos) && !robotIndex.anyWithin(pos, 0);
+    }
+    void moveRobot(std::size_t robotIndexInWorld, Position newPos) {
+        robots[robotIndexInWorld].moveTo(newPos);
+        robotIndex.move(static_cast<uint32_t>(robotIndexInWorld), newPos);
     }
     [[nodiscard]] auto isPlayerOnExit() const noexcept -> bool {
         return std::ranges::any_of(exits, [&](const Exit &exit) -> bool { return exit.pos == player.pos; });
     }
     [[nodiscard]] auto isRobotOnPlayer() const noexcept -> bool {
-        return std::ranges::any_of(robots, [&](const Robot &robot) -> bool { return robot.pos == player.pos; });
+        return robotIndex.anyWithin(player.pos, 0);
     }
+    // Picks a uniformly distributed position from all field positions accepted by `fn`. Random positions
+    // are tried first, so this does not depend on the field size. Only if they all fail, the field is
+    // scanned once, choosing among the valid positions with reservoir sampling.
     template<typename Fn>
-    auto randomValidFieldPosition(Fn fn) const -> Position {
-        auto validPositions = field.filterPositions(fn);
-        if (validPositions.empty()) {
+    auto randomValidFieldPosition(Fn fn) -> Position {
+        constexpr int cRandomAttempts = 256;
+        const auto &rect = field.rect;
+        for (int attempt = 0; attempt < cRandomAttempts; ++attempt) {
+            const auto pos = rect.pos + Position{
+                random.nextInt(0, rect.size.width - 1), random.nextInt(0, rect.size.height - 1)};
+            if (field.contains(pos) && fn(pos)) { return pos; }
+        }
+        std::optional<Position> result;
+        int validCount = 0;
+        rect.forEach([&](Position pos) {
+            if (!field.contains(pos) || !fn(pos)) { return; }
+            ++validCount;
+            if (random.nextInt(1, validCount) == 1) { result = pos; }
+        });
+        if (!result) {
             throw std::logic_error{"Could not find a valid position"};
         }
-        return validPositions[randomInt(0, validPositions.size() - 1)];
+        return *result;
     }
     void addExitAtRandomPosition() {
         auto exit = Exit{randomValidFieldPosition([](Position pos){return true;})};
@@ -105,19 +112,71 @@ struct World {
     }
     void setPlayerToRandomPosition() {
         player.pos = randomValidFieldPosition([&](Position pos) {
-            return !tooNear(pos, 3, exits);
+            return !tooNear(pos, cPlayerExitDistance, exits);
         });
     }
+    void addRobot(Position pos) {
+        robotIndex.add(pos);
+        robots.emplace_back(Robot{pos});
+    }
     void addRobotAtRandomPosition() {
-        auto robot = Robot{randomValidFieldPosition([&](Position pos) {
-            if (player.pos.distanceTo(pos) <= 4) { return false; }
-            return !tooNear(pos, 4, exits) && !tooNear(pos, 1, robots);
-        })};
-        robot.name = std::format("Robot {}", robots.size() + 1);
-        robots.emplace_back(std::move(robot));
+        addRobot(randomValidFieldPosition([&](Position pos) {
+            if (player.pos.distanceTo(pos) <= cRobotPlayerDistance) { return false; }
+            return !tooNear(pos, cRobotExitDistance, exits) && !robotIndex.anyWithin(pos, cRobotRobotDistance);
+        }));
+    }
+    void clearElements() noexcept {
+        player = {};
+        robots.clear();
+        robotIndex.clear();
+        exits.clear();
+    }
+    /// Replace all elements, e.g. from a snapshot. Only allocates if there are more elements than before.
+    void setElements(const Player &newPlayer, std::span<const Robot> newRobots, std::span<const Exit> newExits) {
+        player = newPlayer;
+        robots.assign(newRobots.begin(), newRobots.end());
+        exits.assign(newExits.begin(), newExits.end());
+        robotIndex.clear();
+        for (const auto &robot : robots) {
+            robotIndex.add(robot.pos);
+        }
+    }
+    /// The number of cells within `distance` of a position, if none of them is outside the field.
+    [[nodiscard]] constexpr static auto cellsWithin(int distance) noexcept -> int64_t {
+        return 2 * static_cast<int64_t>(distance) * (distance + 1) + 1;
+    }
+    /// Test if `populate` succeeds for every random choice: each element excludes at most the cells
+    /// around the elements placed before it, so enough walkable cells guarantee a free cell for it.
+    [[nodiscard]] constexpr static auto canAlwaysPopulate(int64_t walkableCellCount, int robotCount) noexcept -> bool {
+        if (walkableCellCount <= cellsWithin(cPlayerExitDistance)) { return false; }
+        if (robotCount == 0) { return true; }
+        const auto excludedForLastRobot = cellsWithin(cRobotPlayerDistance) + cellsWithin(cRobotExitDistance)
+            + (robotCount - 1) * cellsWithin(cRobotRobotDistance);
+        return walkableCellCount > excludedForLastRobot;
+    }
+    void populate(int robotCount) {
+        addExitAtRandomPosition();
+        setPlayerToRandomPosition();
+        for (int i = 0; i < robotCount; ++i) {
+            addRobotAtRandomPosition();
+        }
+    }
+    // Shows the whole field if it fits on the canvas. Otherwise the canvas is a viewport that
+    // follows the player, so rendering only depends on the canvas size.
+    [[nodiscard]] auto viewportTopLeft(Size canvasSize) const noexcept -> Position {
+        const auto centered = canvasSize.center() - field.rect.center();
+        auto axis = [](int centeredValue, int canvasLength, int gridStart, int gridLength, int playerValue) -> int {
+            if (gridLength <= canvasLength) { return centeredValue; }
+            return -std::clamp(playerValue - canvasLength / 2, gridStart, gridStart + gridLength - canvasLength);
+        };
+        const auto &gridRect = field.gridRect;
+        return Position{
+            axis(centered.x, canvasSize.width, gridRect.pos.x, gridRect.size.width, player.pos.x),
+            axis(centered.y, canvasSize.height, gridRect.pos.y, gridRect.size.height, player.pos.y)};
     }
     void render(Canvas &canvas) const noexcept {
-        canvas.setTopLeft(canvas.size.center() - field.rect.center());
+        const auto profileScope = ProfileScope{ProfilePoint::WorldRender};
+        canvas.setTopLeft(viewportTopLeft(canvas.size));
         field.render(canvas);
         for (const auto &exit : exits) {
             exit.render(canvas);
@@ -0,0 +1,50 @@
+#include "Bitboard.hpp"
+#include "Logic.hpp"
+#include "Profiler.hpp"
+#include "Simulation.hpp"
+#include "TestLevels.hpp"
+
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <string_view>
+
+static_assert(cProfilingEnabled, "The allocations are only counted with ROBOT_ESCAPE_PROFILING.");
+
+// Plays a few games, so the containers of the logic reach their final size, and then counts the
+// heap allocations of the games that follow, including their setup. There must be none.
+template<typename tLogic>
+auto expectNoAllocations(std::string_view name, const Simulation &simulation) -> bool {
+    constexpr uint64_t cWarmUpGames = 16;
+    constexpr uint64_t cMeasuredGames = 200;
+    auto runner = GameRunner<tLogic>{simulation};
+    runner.warmUp(cWarmUpGames);
+    const auto allocationsBefore = Profiler::allocationCount;
+    for (uint64_t i = 0; i < cMeasuredGames; ++i) {
+        runner.playGame();
+    }
+    const auto allocations = Profiler::allocationCount - allocationsBefore;
+    std::cout << std::format("{:<32} {:>8} turns, {} allocations: {}\n",
+        name, runner.statistics.totalTurns, allocations, allocations == 0 ? "ok" : "FAILED");
+    return allocations == 0;
+}
+
+auto main() -> int {
+    auto isSuccess = true;
+    isSuccess &= expectNoAllocations<Logic>("field, greedy robots, bfs player", Simulation{
+        .field = makeField(512, 200), .robotCount = 50,
+        .robotStrategy = RobotStrategy::Greedy, .playerPolicy = PlayerPolicy::BfsToExit});
+    isSuccess &= expectNoAllocations<Logic>("field, flow field, random player", Simulation{
+        .field = makeField(512, 200), .robotCount = 50,
+        .robotStrategy = RobotStrategy::FlowField, .playerPolicy = PlayerPolicy::Random});
+    isSuccess &= expectNoAllocations<Logic>("field, U-shaped level", Simulation{
+        .field = makeUField(), .robotCount = 3,
+        .robotStrategy = RobotStrategy::FlowField, .playerPolicy = PlayerPolicy::BfsToExit});
+    isSuccess &= expectNoAllocations<BitboardLogic>("bitboard, greedy robots", Simulation{
+        .field = makeField(64, 8), .robotCount = 16,
+        .robotStrategy = RobotStrategy::Greedy, .playerPolicy = PlayerPolicy::BfsToExit});
+    isSuccess &= expectNoAllocations<BitboardLogic>("bitboard, flow field", Simulation{
+        .field = makeField(64, 8), .robotCount = 16,
+        .robotStrategy = RobotStrategy::FlowField, .playerPolicy = PlayerPolicy::GreedyToExit});
+    return isSuccess ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include "Bitboard.hpp"
+#include "Logic.hpp"
+#include "Random.hpp"
+#include "Simulation.hpp"
+#include "TestLevels.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <string_view>
+
+[[nodiscard]] auto hasSamePositions(const World &world, const World &other) noexcept -> bool {
+    return world.player.pos == other.player.pos
+        && std::ranges::equal(world.robots, other.robots, {}, &Robot::pos, &Robot::pos)
+        && std::ranges::equal(world.exits, other.exits, {}, &Exit::pos, &Exit::pos);
+}
+
+// Plays the same games with `Logic` and `BitboardLogic`, and compares the positions of all elements
+// after the start and after every turn. The bit planes must play exactly the same games.
+auto expectSameGames(std::string_view name, const Simulation &simulation) -> bool {
+    constexpr uint64_t cGames = 400;
+    auto logic = Logic{World{simulation.field}, simulation.robotStrategy};
+    auto bitboardLogic = BitboardLogic{World{simulation.field}, simulation.robotStrategy};
+    auto controller = PlayerController{simulation.playerPolicy};
+    const auto runRandom = Random{6};
+    uint64_t turns = 0;
+    for (uint64_t game = 0; game < cGames; ++game) {
+        auto gameRandom = runRandom.stream(game);
+        logic.startGame(gameRandom, simulation.robotCount);
+        bitboardLogic.startGame(gameRandom, simulation.robotCount);
+        controller.startGame(logic.world, gameRandom.split());
+        for (int turn = 0;; ++turn) {
+            if (!hasSamePositions(logic.world, bitboardLogic.world) || logic.gameState() != bitboardLogic.gameState()) {
+                std::cout << std::format("{:<40} game {}, turn {} differs: FAILED\n", name, game, turn);
+                return false;
+            }
+            if (logic.gameState() != GameState::Running || turn == simulation.maxTurns) { break; }
+            const auto input = controller.nextInput(logic.world);
+            if (logic.advance(input) != bitboardLogic.advance(input)) {
+                std::cout << std::format("{:<40} game {}, turn {}, the player moves differ: FAILED\n", name, game, turn);
+                return false;
+            }
+            ++turns;
+        }
+    }
+    std::cout << std::format("{:<40} {:>8} turns: ok\n", name, turns);
+    return true;
+}
+
+auto main() -> int {
+    auto isSuccess = true;
+    for (const auto isAvx2 : {false, true}) {
+        if (isAvx2 && !BitboardSweep::hasAvx2) {
+            std::cout << "The CPU has no AVX2, only the scalar sweep was compared.\n";
+            continue;
+        }
+        BitboardSweep::useAvx2 = isAvx2;
+        const auto kernel = isAvx2 ? std::string_view{"avx2"} : std::string_view{"scalar"};
+        isSuccess &= expectSameGames(std::format("{}, 64x64, greedy, random player", kernel), Simulation{
+            .field = makeField(64, 8), .robotCount = 16,
+            .robotStrategy = RobotStrategy::Greedy, .playerPolicy = PlayerPolicy::Random, .maxTurns = 200});
+        isSuccess &= expectSameGames(std::format("{}, 64x64, flow field, random player", kernel), Simulation{
+            .field = makeField(64, 8), .robotCount = 16,
+            .robotStrategy = RobotStrategy::FlowField, .playerPolicy = PlayerPolicy::Random, .maxTurns = 200});
+        isSuccess &= expectSameGames(std::format("{}, 37x37, greedy, bfs player", kernel), Simulation{
+            .field = makeField(37, 5), .robotCount = 3,
+            .robotStrategy = RobotStrategy::Greedy, .playerPolicy = PlayerPolicy::BfsToExit, .maxTurns = 200});
+        isSuccess &= expectSameGames(std::format("{}, 37x37, flow field, bfs player", kernel), Simulation{
+            .field = makeField(37, 5), .robotCount = 3,
+            .robotStrategy = RobotStrategy::FlowField, .playerPolicy = PlayerPolicy::BfsToExit, .maxTurns = 200});
+    }
+    return isSuccess ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Field.hpp"
+#include "Logic.hpp"
+#include "Random.hpp"
+#include "Simulation.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Levels and helpers that are shared by the tests and the benchmarks.
+
+// Builds a connected field: random rooms, each joined by a vertical corridor to one long horizontal
+// corridor through the middle. The same arguments always give the same field.
+inline auto makeField(int fieldSize, int roomCount) -> Field {
+    auto random = Random{static_cast<uint64_t>(fieldSize) * 1000003U + static_cast<uint64_t>(roomCount)};
+    const auto corridorY = fieldSize / 2;
+    std::vector<Rectangle> roomRects;
+    roomRects.emplace_back(0, corridorY - 1, fieldSize, 3);
+    for (int i = 0; i < roomCount; ++i) {
+        const auto width = random.nextInt(4, 20);
+        const auto height = random.nextInt(4, 12);
+        const auto x = random.nextInt(0, fieldSize - width);
+        const auto y = random.nextInt(0, fieldSize - height);
+        roomRects.emplace_back(x, y, width, height);
+        const auto corridorX = x + width / 2;
+        const auto top = std::min(y + height / 2, corridorY);
+        const auto bottom = std::max(y + height / 2, corridorY);
+        roomRects.emplace_back(corridorX, top, 1, bottom - top + 1);
+    }
+    Field field;
+    field.addRooms(roomRects);
+    return field;
+}
+
+// Two long legs joined at the top, so the shortest path to an exit often leaves the region
+// that the player policy searches first.
+inline auto makeUField() -> Field {
+    Field field;
+    field.addRooms(std::vector{Rectangle{0, 0, 1, 300}, Rectangle{0, 0, 200, 1}, Rectangle{199, 0, 1, 300}});
+    return field;
+}
+
+// Plays the games of a simulation one after the other, with one logic and one controller, like a
+// worker of `Simulation::run`. The first games grow the containers to their final size, so `warmUp`
+// plays them before anything is measured.
+template<typename tLogic>
+struct GameRunner {
+    const Simulation &simulation;
+    tLogic logic;
+    PlayerController controller;
+    SimulationStatistics statistics; // of the games after the warm-up.
+    Random runRandom{5};
+    uint64_t game{};
+
+    explicit GameRunner(const Simulation &simulation)
+        : simulation{simulation}, logic{World{simulation.field}, simulation.robotStrategy}, controller{simulation.playerPolicy} {
+    }
+
+    void warmUp(uint64_t games) {
+        for (uint64_t i = 0; i < games; ++i) {
+            playGame();
+        }
+        statistics = SimulationStatistics{};
+    }
+
+    void playGame() {
+        simulation.playGame(logic, controller, runRandom.stream(game++), statistics);
+    }
+};